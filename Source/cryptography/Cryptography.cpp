@@ -236,13 +236,20 @@ namespace Implementation {
     };
 
     class RPCHashImpl : public Exchange::IHash {
+    private:
+        // Small ingests are collected locally and handed over in one call, to save round trips.
+        static constexpr uint32_t CoalesceSize = 4096;
+
     public:
         RPCHashImpl(Exchange::IHash* hash)
             : _accessor(hash)
+            , _buffer()
+            , _failed(false)
         {
             if (_accessor != nullptr) {
                 _accessor->AddRef();
             }
+            _buffer.reserve(CoalesceSize);
         }
         ~RPCHashImpl() override = default;
 
@@ -254,15 +261,50 @@ namespace Implementation {
         /* Ingest data into the hash calculator (multiple calls possible) */
         uint32_t Ingest(const uint32_t length, const uint8_t data[] /* @length:length */) override
         {
+            uint32_t result = 0;
+
             Core::SafeSyncType<Core::CriticalSection> lock(_adminLock);
-            return (_accessor != nullptr ? _accessor->Ingest(length, data) : 0);
+
+            if ((_accessor != nullptr) && (_failed == false)) {
+                if ((_buffer.size() + length) > CoalesceSize) {
+                    Flush();
+                }
+
+                if (_failed == false) {
+                    if (length >= CoalesceSize) {
+                        result = _accessor->Ingest(length, data);
+                        _failed = (result != length);
+                    } else {
+                        _buffer.insert(_buffer.end(), data, (data + length));
+                        result = length;
+                    }
+                }
+            }
+
+            return (result);
         }
 
         /* Calculate the hash from all ingested data */
         uint8_t Calculate(const uint8_t maxLength, uint8_t data[] /* @out @maxlength:maxLength */) override
         {
+            uint8_t result = 0;
+
             Core::SafeSyncType<Core::CriticalSection> lock(_adminLock);
-            return (_accessor != nullptr ? _accessor->Calculate(maxLength, data) : 0);
+
+            if (_accessor != nullptr) {
+                Flush();
+
+                if (_failed == false) {
+                    result = _accessor->Calculate(maxLength, data);
+                } else {
+                    TRACE_L1("Data ingested earlier was not accepted, no hash calculated");
+                }
+            }
+
+            _buffer.clear();
+            _failed = false;
+
+            return (result);
         }
 
         void Unlink()
@@ -272,11 +314,25 @@ namespace Implementation {
                 _accessor->Release();
                 _accessor = nullptr;
             }
+            _buffer.clear();
+        }
+
+    private:
+        void Flush()
+        {
+            if ((_buffer.empty() == false) && (_failed == false)) {
+                const uint32_t length = static_cast<uint32_t>(_buffer.size());
+                _failed = (_accessor->Ingest(length, _buffer.data()) != length);
+            }
+
+            _buffer.clear();
         }
 
     private:
         Core::CriticalSection _adminLock;
         Exchange::IHash* _accessor;
+        std::vector<uint8_t> _buffer;
+        bool _failed;
     };
 
     class RPCVaultImpl : public Exchange::IVault {
@@ -951,6 +1007,28 @@ namespace Exchange {
 
 namespace Cryptography {
 
+    uint8_t Hash(Exchange::ICryptography* cryptography, const Exchange::hashtype hashType,
+        const uint32_t length, const uint8_t data[], const uint8_t maxLength, uint8_t digest[])
+    {
+        uint8_t result = 0;
+
+        ASSERT(cryptography != nullptr);
+
+        Exchange::IHash* hash = cryptography->Hash(hashType);
+
+        if (hash == nullptr) {
+            TRACE_L1("Hash type %i not available", hashType);
+        } else {
+            if (hash->Ingest(length, data) == length) {
+                result = hash->Calculate(maxLength, digest);
+            }
+
+            hash->Release();
+        }
+
+        return (result);
+    }
+
     Exchange::CryptographyVault VaultId(const string& label)
     {
         Exchange::CryptographyVault vaultId = static_cast<Exchange::CryptographyVault>(~0);
@@ -31,6 +31,10 @@ namespace Cryptography {
 
 EXTERNAL Exchange::CryptographyVault VaultId(const string& label);
 
+// One-shot hash of a single buffer, returns the digest length (0 on failure).
+EXTERNAL uint8_t Hash(Exchange::ICryptography* cryptography, const Exchange::hashtype hashType,
+    const uint32_t length, const uint8_t data[], const uint8_t maxLength, uint8_t digest[]);
+
 } // namespace Cryptography
 
 }
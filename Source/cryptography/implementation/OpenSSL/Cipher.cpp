@@ -43,6 +43,13 @@ struct CipherImplementation {
         const uint32_t inputLength, const uint8_t input[],
         const uint32_t maxOutputLength, uint8_t output[]) const = 0;
 
+    virtual bool Init(const bool encrypt, const uint8_t ivLength, const uint8_t iv[]) = 0;
+
+    virtual int32_t Update(const uint32_t inputLength, const uint8_t input[],
+        const uint32_t maxOutputLength, uint8_t output[]) = 0;
+
+    virtual int32_t Final(const uint32_t maxOutputLength, uint8_t output[]) = 0;
+
     virtual ~CipherImplementation() {}
 };
 
@@ -66,11 +73,12 @@ public:
     Cipher() = delete;
 
     Cipher(const Implementation::Vault* vault, const EVP_CIPHER* cipher, const uint32_t keyId, const uint8_t keyLength, const uint8_t ivLength)
-        : _context(nullptr)
-        , _vault(vault)
-        , _cipher(cipher)
+        : _vault(vault)
+        , _encryptContext(nullptr)
+        , _decryptContext(nullptr)
+        , _streamContext(nullptr)
+        , _streaming(false)
         , _keyId(keyId)
-        , _keyLength(keyLength)
         , _ivLength(ivLength)
     {
         ASSERT(vault != nullptr);
@@ -79,14 +87,37 @@ public:
         ASSERT(keyLength != 0);
         ASSERT(ivLength != 0);
 
-        _context = EVP_CIPHER_CTX_new();
-        ASSERT(_context != nullptr);
+        // The key is taken out of the vault only once, to set up the key
+        // schedules of both directions (they differ for the block modes).
+        // From then on the clear key only lives in the OpenSSL contexts, and
+        // every call merely resets the IV. The contexts are only used while
+        // the key is still in the vault, a deleted key stops them right away.
+        uint8_t* keyBuf = reinterpret_cast<uint8_t*>(ALLOCA(keyLength));
+        ASSERT(keyBuf != nullptr);
+
+        uint16_t length = vault->Export(keyId, keyLength, keyBuf, true);
+        ASSERT(length != 0);
+
+        if (length != keyLength) {
+            TRACE_L1("Failed to retrieve a valid encryption key from id 0x%08x", keyId);
+        } else {
+            _encryptContext = Keyed(cipher, keyBuf, true);
+            _decryptContext = Keyed(cipher, keyBuf, false);
+        }
+
+        ::memset(keyBuf, 0x00, keyLength);
     }
 
     ~Cipher() override
     {
-        if (_context != nullptr) {
-            EVP_CIPHER_CTX_free(_context);
+        if (_encryptContext != nullptr) {
+            EVP_CIPHER_CTX_free(_encryptContext);
+        }
+        if (_decryptContext != nullptr) {
+            EVP_CIPHER_CTX_free(_decryptContext);
+        }
+        if (_streamContext != nullptr) {
+            EVP_CIPHER_CTX_free(_streamContext);
         }
     }
 
@@ -94,18 +125,144 @@ public:
         const uint32_t inputLength, const uint8_t input[],
         const uint32_t maxOutputLength, uint8_t output[]) const override
     {
-        return (Operation(true, ivLength, iv, inputLength, input, maxOutputLength, output));
+        return (Operation(_encryptContext, ivLength, iv, inputLength, input, maxOutputLength, output));
     }
 
     int32_t Decrypt(const uint8_t ivLength, const uint8_t iv[],
         const uint32_t inputLength, const uint8_t input[],
         const uint32_t maxOutputLength, uint8_t output[]) const override
     {
-        return (Operation(false, ivLength, iv, inputLength, input, maxOutputLength, output));
+        return (Operation(_decryptContext, ivLength, iv, inputLength, input, maxOutputLength, output));
+    }
+
+    bool Init(const bool encrypt, const uint8_t ivLength, const uint8_t iv[]) override
+    {
+        bool result = false;
+
+        ASSERT(iv != nullptr);
+
+        // The stream gets a copy of the keyed context, so one-shot operations can still be done in between.
+        EVP_CIPHER_CTX* keyed = (encrypt ? _encryptContext : _decryptContext);
+
+        _streaming = false;
+
+        if (ivLength != _ivLength) {
+            TRACE_L1("Invalid IV length! [%i]", ivLength);
+        } else if ((keyed == nullptr) || (Present() == false)) {
+            TRACE_L1("No valid encryption key for id 0x%08x", _keyId);
+        } else {
+            if (_streamContext == nullptr) {
+                _streamContext = EVP_CIPHER_CTX_new();
+                ASSERT(_streamContext != nullptr);
+            }
+
+            ERR_clear_error();
+
+            if (_streamContext == nullptr) {
+                TRACE_L1("Failed to allocate a cipher context");
+            } else if (EVP_CIPHER_CTX_copy(_streamContext, keyed) == 0) {
+                TRACE_L1("EVP_CIPHER_CTX_copy() failed: %s", GetSSLError().c_str());
+            } else if (EVP_CipherInit_ex(_streamContext, nullptr, nullptr, nullptr, iv, -1) == 0) {
+                TRACE_L1("EVP_CipherInit_ex() failed: %s", GetSSLError().c_str());
+            } else {
+                _streaming = true;
+                result = true;
+            }
+        }
+
+        return (result);
+    }
+
+    int32_t Update(const uint32_t inputLength, const uint8_t input[],
+        const uint32_t maxOutputLength, uint8_t output[]) override
+    {
+        int32_t result = -1;
+
+        ASSERT(input != nullptr);
+        ASSERT(inputLength != 0);
+
+        if (_streaming == false) {
+            TRACE_L1("No cipher stream in progress");
+        } else {
+            const uint32_t blockSize = EVP_CIPHER_CTX_block_size(_streamContext);
+            const uint32_t required = (inputLength + (blockSize > 1 ? blockSize : 0));
+
+            if (maxOutputLength < required) {
+                TRACE_L1("Too small output buffer, expected: %i bytes", required);
+                result = -static_cast<int32_t>(required);
+            } else {
+                int len = 0;
+
+                ERR_clear_error();
+
+                if (EVP_CipherUpdate(_streamContext, output, &len, input, inputLength) == 0) {
+                    TRACE_L1("EVP_CipherUpdate() failed: %s", GetSSLError().c_str());
+                    _streaming = false;
+                } else {
+                    result = len;
+                }
+            }
+        }
+
+        return (result);
+    }
+
+    int32_t Final(const uint32_t maxOutputLength, uint8_t output[]) override
+    {
+        int32_t result = -1;
+
+        if (_streaming == false) {
+            TRACE_L1("No cipher stream in progress");
+        } else {
+            const uint32_t required = EVP_CIPHER_CTX_block_size(_streamContext);
+
+            if (maxOutputLength < required) {
+                TRACE_L1("Too small output buffer, expected: %i bytes", required);
+                result = -static_cast<int32_t>(required);
+            } else {
+                int len = 0;
+
+                ERR_clear_error();
+
+                if (EVP_CipherFinal_ex(_streamContext, output, &len) == 0) {
+                    TRACE_L1("EVP_CipherFinal_ex() failed: %s", GetSSLError().c_str());
+                } else {
+                    result = len;
+                }
+
+                _streaming = false;
+            }
+        }
+
+        return (result);
     }
 
 private:
-    int32_t Operation(bool encrypt,
+    // The key may have been deleted from the vault since the contexts were keyed.
+    bool Present() const
+    {
+        return (_vault->Size(_keyId, true) != 0);
+    }
+
+    static EVP_CIPHER_CTX* Keyed(const EVP_CIPHER* cipher, const uint8_t key[], const bool encrypt)
+    {
+        EVP_CIPHER_CTX* context = EVP_CIPHER_CTX_new();
+        ASSERT(context != nullptr);
+
+        if (context != nullptr) {
+            ERR_clear_error();
+
+            if (EVP_CipherInit_ex(context, cipher, nullptr, key, nullptr, encrypt) == 0) {
+                TRACE_L1("EVP_CipherInit_ex() failed: %s", GetSSLError().c_str());
+                EVP_CIPHER_CTX_free(context);
+                context = nullptr;
+            }
+        }
+
+        return (context);
+    }
+
+    int32_t Operation(EVP_CIPHER_CTX* context,
         const uint8_t ivLength, const uint8_t iv[],
         const uint32_t inputLength, const uint8_t input[],
         const uint32_t maxOutputLength, uint8_t output[]) const
@@ -123,38 +280,30 @@ private:
             // Note: Pitfall, AES CBC/ECB will use padding
             TRACE_L1("Too small output buffer, expected: %i bytes", inputLength);
             result = (-static_cast<int32_t>(inputLength + (16 - (inputLength % 16))));
+        } else if ((context == nullptr) || (Present() == false)) {
+            TRACE_L1("No valid encryption key for id 0x%08x", _keyId);
         } else {
-            uint8_t* keyBuf = reinterpret_cast<uint8_t*>(ALLOCA(_keyLength));
-            ASSERT(keyBuf != nullptr);
+            ERR_clear_error();
+            int len = 0;
+            const bool encrypt = (context == _encryptContext);
 
-            uint16_t length = _vault->Export(_keyId, _keyLength, keyBuf, true);
-            ASSERT(length != 0);
-
-            if (length != _keyLength) {
-                TRACE_L1("Failed to retrieve a valid encryption key from id 0x%08x", _keyId);
+            // Without a cipher and key the key schedule is kept, only the IV is set.
+            if (EVP_CipherInit_ex(context, nullptr, nullptr, nullptr, iv, -1) == 0) {
+                TRACE_L1("EVP_CipherInit_ex() failed: %s", GetSSLError().c_str());
             } else {
-                ERR_clear_error();
-                int len = 0;
-                int initResult = EVP_CipherInit_ex(_context, _cipher, nullptr, keyBuf, iv, encrypt);
-                ::memset(keyBuf, 0x00, length);
-
-                if (initResult == 0) {
-                    TRACE_L1("EVP_CipherInit_ex() failed: %s", GetSSLError().c_str());
+                if (EVP_CipherUpdate(context, output, &len, input, inputLength) == 0) {
+                    TRACE_L1("EVP_CipherUpdate() failed: %s", GetSSLError().c_str());
                 } else {
-                    if (EVP_CipherUpdate(_context, output, &len, input, inputLength) == 0) {
-                        TRACE_L1("EVP_CipherUpdate() failed: %s", GetSSLError().c_str());
+                    result = len;
+                    len = 0;
+                    // Note: EVP_CipherFinal_ex() can still write to the output buffer!
+                    if (EVP_CipherFinal_ex(context, (output + result), &len) == 0) {
+                        TRACE_L1("EVP_CipherFinal_ex() failed: %s", GetSSLError().c_str());
+                        result = 0;
                     } else {
-                        result = len;
-                        len = 0;
-                        // Note: EVP_CipherFinal_ex() can still write to the output buffer!
-                        if (EVP_CipherFinal_ex(_context, (output + result), &len) == 0) {
-                            TRACE_L1("EVP_CipherFinal_ex() failed: %s", GetSSLError().c_str());
-                            result = 0;
-                        } else {
-                            result += len;
-                            TRACE_L2("Completed %scryption, input size: %i, output size: %i",
-                                (encrypt ? "en" : "de"), inputLength, result);
-                        }
+                        result += len;
+                        TRACE_L2("Completed %scryption, input size: %i, output size: %i",
+                            (encrypt ? "en" : "de"), inputLength, result);
                     }
                 }
             }
@@ -164,11 +313,12 @@ private:
     }
 
 private:
-    EVP_CIPHER_CTX* _context;
     const Implementation::Vault* _vault;
-    const EVP_CIPHER* _cipher;
+    EVP_CIPHER_CTX* _encryptContext;
+    EVP_CIPHER_CTX* _decryptContext;
+    EVP_CIPHER_CTX* _streamContext;
+    bool _streaming;
     uint32_t _keyId;
-    uint8_t _keyLength;
     uint8_t _ivLength;
 };
 
@@ -271,4 +421,23 @@ int32_t cipher_decrypt(const struct CipherImplementation* cipher, const uint8_t
     return (cipher->Decrypt(iv_length, iv, input_length, input, max_output_length, output));
 }
 
+bool cipher_init(struct CipherImplementation* cipher, const bool encrypt, const uint8_t iv_length, const uint8_t iv[])
+{
+    ASSERT(cipher != nullptr);
+    return (cipher->Init(encrypt, iv_length, iv));
+}
+
+int32_t cipher_update(struct CipherImplementation* cipher,
+    const uint32_t input_length, const uint8_t input[], const uint32_t max_output_length, uint8_t output[])
+{
+    ASSERT(cipher != nullptr);
+    return (cipher->Update(input_length, input, max_output_length, output));
+}
+
+int32_t cipher_final(struct CipherImplementation* cipher, const uint32_t max_output_length, uint8_t output[])
+{
+    ASSERT(cipher != nullptr);
+    return (cipher->Final(max_output_length, output));
+}
+
 } // extern "C"
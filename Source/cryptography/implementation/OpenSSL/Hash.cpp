@@ -28,6 +28,11 @@
 #include <openssl/hmac.h>
 #include <openssl/evp.h>
 
+#include <map>
+#include <tuple>
+
+#include "Hash.h"
+#include "MultiBuffer.h"
 #include "Vault.h"
 
 
@@ -101,6 +106,202 @@ namespace Operation {
 
 } // namespace Operation
 
+// HMAC contexts keyed once per (vault, digest, secret) and handed out as copies of that saved key state,
+// so creating an HMAC does not need a vault export and a fresh key setup every time.
+class KeyedContexts {
+private:
+    static constexpr uint8_t MaxKeys = 16;
+    static constexpr uint8_t MaxIdle = 4;
+
+    using Key = std::tuple<const Implementation::Vault*, const EVP_MD*, uint32_t>;
+
+    struct Entry {
+        EVP_PKEY* pkey;
+        EVP_MD_CTX* keyed;
+        std::vector<EVP_MD_CTX*> idle;
+        uint64_t used;
+    };
+
+    KeyedContexts()
+        : _lock()
+        , _entries()
+        , _uses(0)
+    {
+    }
+
+public:
+    KeyedContexts(const KeyedContexts&) = delete;
+    KeyedContexts& operator=(const KeyedContexts&) = delete;
+
+    ~KeyedContexts()
+    {
+        for (auto& entry : _entries) {
+            Dispose(entry.second);
+        }
+    }
+
+    static KeyedContexts& Instance()
+    {
+        // Intentionally leaked: the static vaults revoke their secrets from their destructors at exit,
+        // which may run after a function-local static pool would already have been destructed.
+        static KeyedContexts& instance = *new KeyedContexts();
+        return (instance);
+    }
+
+public:
+    EVP_MD_CTX* Acquire(const Implementation::Vault* vault, const EVP_MD* digest, const uint32_t secretId, const uint16_t secretLength)
+    {
+        EVP_MD_CTX* ctx = nullptr;
+
+        _lock.Lock();
+
+        auto it = _entries.find(Key(vault, digest, secretId));
+
+        if (it == _entries.end()) {
+            Entry entry;
+
+            if (Create(vault, digest, secretId, secretLength, entry) == true) {
+                if (_entries.size() >= MaxKeys) {
+                    Evict();
+                }
+
+                it = _entries.emplace(Key(vault, digest, secretId), std::move(entry)).first;
+            }
+        }
+
+        if (it != _entries.end()) {
+            Entry& entry = it->second;
+            entry.used = ++_uses;
+
+            if (entry.idle.empty() == false) {
+                ctx = entry.idle.back();
+                entry.idle.pop_back();
+            } else {
+                ctx = EVP_MD_CTX_create();
+                ASSERT(ctx != nullptr);
+            }
+
+            if ((ctx != nullptr) && (EVP_MD_CTX_copy_ex(ctx, entry.keyed) == 0)) {
+                TRACE_L1("EVP_MD_CTX_copy_ex() failed");
+                EVP_MD_CTX_destroy(ctx);
+                ctx = nullptr;
+            }
+        }
+
+        _lock.Unlock();
+
+        return (ctx);
+    }
+
+    void Relinquish(const Implementation::Vault* vault, const EVP_MD* digest, const uint32_t secretId, EVP_MD_CTX* ctx)
+    {
+        ASSERT(ctx != nullptr);
+
+        _lock.Lock();
+
+        auto it = _entries.find(Key(vault, digest, secretId));
+
+        if ((it != _entries.end()) && (it->second.idle.size() < MaxIdle)) {
+            it->second.idle.push_back(ctx);
+        } else {
+            EVP_MD_CTX_destroy(ctx);
+        }
+
+        _lock.Unlock();
+    }
+
+    // Drops the saved key state of a secret that is no longer in the vault.
+    void Revoke(const Implementation::Vault* vault, const uint32_t secretId)
+    {
+        _lock.Lock();
+
+        auto it = _entries.begin();
+
+        while (it != _entries.end()) {
+            if ((std::get<0>(it->first) == vault) && (std::get<2>(it->first) == secretId)) {
+                Dispose(it->second);
+                it = _entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        _lock.Unlock();
+    }
+
+private:
+    static bool Create(const Implementation::Vault* vault, const EVP_MD* digest, const uint32_t secretId, const uint16_t secretLength, Entry& entry)
+    {
+        entry.pkey = nullptr;
+        entry.keyed = nullptr;
+        entry.used = 0;
+
+        uint8_t* secret = reinterpret_cast<uint8_t*>(ALLOCA(secretLength));
+        ASSERT(secret != nullptr);
+
+        uint16_t secretLen = vault->Export(secretId, secretLength, secret, true);
+        ASSERT(secretLen != 0);
+
+        if (secretLen != 0) {
+            entry.pkey = EVP_PKEY_new_mac_key(EVP_PKEY_HMAC, nullptr, secret, secretLen);
+            ASSERT(entry.pkey != nullptr);
+        }
+
+        ::memset(secret, 0x00, secretLength);
+
+        if (entry.pkey != nullptr) {
+            entry.keyed = EVP_MD_CTX_create();
+            ASSERT(entry.keyed != nullptr);
+
+            if ((entry.keyed != nullptr) && (Operation::HMAC::Init(entry.keyed, nullptr, digest, entry.pkey) == 0)) {
+                TRACE_L1("Init() failed");
+                EVP_MD_CTX_destroy(entry.keyed);
+                entry.keyed = nullptr;
+            }
+        }
+
+        if ((entry.keyed == nullptr) && (entry.pkey != nullptr)) {
+            EVP_PKEY_free(entry.pkey);
+            entry.pkey = nullptr;
+        }
+
+        return (entry.keyed != nullptr);
+    }
+
+    static void Dispose(Entry& entry)
+    {
+        for (EVP_MD_CTX* ctx : entry.idle) {
+            EVP_MD_CTX_destroy(ctx);
+        }
+
+        entry.idle.clear();
+
+        EVP_MD_CTX_destroy(entry.keyed);
+        EVP_PKEY_free(entry.pkey);
+    }
+
+    void Evict()
+    {
+        auto oldest = _entries.begin();
+
+        for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+            if (it->second.used < oldest->second.used) {
+                oldest = it;
+            }
+        }
+
+        if (oldest != _entries.end()) {
+            Dispose(oldest->second);
+            _entries.erase(oldest);
+        }
+    }
+
+private:
+    Thunder::Core::CriticalSection _lock;
+    std::map<Key, Entry> _entries;
+    uint64_t _uses;
+};
+
 template<typename OPERATION>
 class HashType : public HashImplementation {
 public:
@@ -109,8 +310,9 @@ public:
 
     HashType(const EVP_MD* digest)
         : _ctx(nullptr)
-        , _pkey(nullptr)
         , _vault(nullptr)
+        , _digest(digest)
+        , _secretId(0)
         , _size(0)
         , _failure(false)
     {
@@ -129,38 +331,35 @@ public:
     }
 
     HashType(const Implementation::Vault* vault, const EVP_MD* digest, const uint32_t secretId, const uint16_t secretLength)
-        : HashType(digest)
+        : _ctx(nullptr)
+        , _vault(vault)
+        , _digest(digest)
+        , _secretId(secretId)
+        , _size(EVP_MD_size(digest))
+        , _failure(false)
     {
         ASSERT(vault != nullptr);
+        ASSERT(digest != nullptr);
         ASSERT(secretId != 0);
         ASSERT(secretLength != 0);
-        _vault = vault;
-
-        if (_failure == false) {
-            uint8_t* secret = reinterpret_cast<uint8_t*>(ALLOCA(secretLength));
-            ASSERT(secret != nullptr);
-
-            uint16_t secretLen = _vault->Export(secretId, secretLength, secret, true);
-            ASSERT(secretLen != 0);
-
-            if (secretLen != 0) {
-                _pkey = EVP_PKEY_new_mac_key(EVP_PKEY_HMAC, nullptr, secret, secretLen);
-                ASSERT(_pkey != nullptr);
+        ASSERT(_size != 0);
 
-                ::memset(secret, 0x00, secretLen);
+        _ctx = KeyedContexts::Instance().Acquire(vault, digest, secretId, secretLength);
 
-                if (OPERATION::Init(_ctx, nullptr, digest, _pkey) == 0) {
-                    TRACE_L1("Init() failed");
-                    _failure = true;
-                }
-            }
+        if (_ctx == nullptr) {
+            TRACE_L1("Failed to set up a keyed context for secret id 0x%08x", secretId);
+            _failure = true;
         }
     }
 
     ~HashType() override
     {
         if (_ctx != nullptr) {
-            EVP_MD_CTX_destroy(_ctx);
+            if (_vault != nullptr) {
+                KeyedContexts::Instance().Relinquish(_vault, _digest, _secretId, _ctx);
+            } else {
+                EVP_MD_CTX_destroy(_ctx);
+            }
         }
     }
 
@@ -206,12 +405,131 @@ public:
 
 private:
     EVP_MD_CTX* _ctx;
-    EVP_PKEY* _pkey;
     const Implementation::Vault* _vault;
+    const EVP_MD* _digest;
+    uint32_t _secretId;
     uint16_t _size;
     bool _failure;
 };
 
+namespace Batch {
+
+    MultiBuffer::SHA256Engine Lanes()
+    {
+        MultiBuffer::SHA256Engine engine = nullptr;
+
+#if defined(HASH_MULTIBUFFER_AVX2)
+        if (__builtin_cpu_supports("avx2")) {
+            engine = MultiBuffer::SHA256AVX2;
+        }
+#elif defined(__ARM_NEON)
+        engine = MultiBuffer::SHA256NEON;
+#endif
+
+        return (engine);
+    }
+
+    // HMAC-SHA256 inner and outer start states, i.e. with the padded key block already hashed.
+    void Keyed(const uint8_t key[], const uint16_t keyLength, uint32_t inner[8], uint32_t outer[8])
+    {
+        uint8_t padded[MultiBuffer::BlockSize];
+        uint32_t words[16];
+
+        ::memset(padded, 0x00, sizeof(padded));
+
+        if (keyLength > sizeof(padded)) {
+            unsigned int length = 0;
+            EVP_Digest(key, keyLength, padded, &length, EVP_sha256(), nullptr);
+        } else {
+            ::memcpy(padded, key, keyLength);
+        }
+
+        for (uint8_t t = 0; t < 16; t++) {
+            words[t] = (MultiBuffer::BigEndian32(&padded[t * 4]) ^ 0x36363636);
+        }
+        ::memcpy(inner, MultiBuffer::InitialState, sizeof(MultiBuffer::InitialState));
+        MultiBuffer::Compress<MultiBuffer::Scalar>(inner, words);
+
+        for (uint8_t t = 0; t < 16; t++) {
+            words[t] = (MultiBuffer::BigEndian32(&padded[t * 4]) ^ 0x5c5c5c5c);
+        }
+        ::memcpy(outer, MultiBuffer::InitialState, sizeof(MultiBuffer::InitialState));
+        MultiBuffer::Compress<MultiBuffer::Scalar>(outer, words);
+
+        ::memset(words, 0x00, sizeof(words));
+        ::memset(padded, 0x00, sizeof(padded));
+    }
+
+    uint32_t Calculate(const hash_type type, const uint8_t key[], const uint16_t keyLength,
+        const uint32_t count, const uint32_t lengths[], const uint8_t* const data[], uint8_t digests[])
+    {
+        uint32_t result = 0;
+
+        const EVP_MD* md = Algorithm(type);
+        const MultiBuffer::SHA256Engine engine = (((type == hash_type::HASH_TYPE_SHA256) && (count > 1)) ? Lanes() : nullptr);
+
+        if (md == nullptr) {
+            TRACE_L1("Hashing algorithm %i not supported", type);
+        } else if (engine != nullptr) {
+            if (key == nullptr) {
+                engine(MultiBuffer::InitialState, 0, count, lengths, data, digests);
+            } else {
+                uint32_t inner[8];
+                uint32_t outer[8];
+
+                Keyed(key, keyLength, inner, outer);
+
+                engine(inner, MultiBuffer::BlockSize, count, lengths, data, digests);
+
+                // The outer hashes take the inner digests as their messages.
+                std::vector<uint8_t> innerDigests(digests, (digests + (static_cast<size_t>(count) * MultiBuffer::DigestSize)));
+                std::vector<const uint8_t*> messages(count);
+                std::vector<uint32_t> sizes(count, MultiBuffer::DigestSize);
+
+                for (uint32_t i = 0; i < count; i++) {
+                    messages[i] = &innerDigests[static_cast<size_t>(i) * MultiBuffer::DigestSize];
+                }
+
+                engine(outer, MultiBuffer::BlockSize, count, sizes.data(), messages.data(), digests);
+
+                ::memset(inner, 0x00, sizeof(inner));
+                ::memset(outer, 0x00, sizeof(outer));
+            }
+
+            result = count;
+        } else {
+            const uint8_t size = static_cast<uint8_t>(EVP_MD_size(md));
+
+            result = count;
+
+            for (uint32_t i = 0; (i < count) && (result != 0); i++) {
+                unsigned int length = 0;
+                uint8_t* digest = (digests + (static_cast<size_t>(i) * size));
+
+                if (key != nullptr) {
+                    if (HMAC(md, key, keyLength, data[i], lengths[i], digest, &length) == nullptr) {
+                        TRACE_L1("HMAC() failed");
+                        result = 0;
+                    }
+                } else if (EVP_Digest(data[i], lengths[i], digest, &length, md, nullptr) == 0) {
+                    TRACE_L1("EVP_Digest() failed");
+                    result = 0;
+                }
+            }
+        }
+
+        TRACE_L2("Calculated %i hashes in a batch of %i", result, count);
+
+        return (result);
+    }
+
+} // namespace Batch
+
+void RevokeKeyedContexts(const Vault* vault, const uint32_t secretId)
+{
+    KeyedContexts::Instance().Revoke(vault, secretId);
+}
+
 } // namespace Implementation
 
 extern "C" {
@@ -237,6 +555,7 @@ HashImplementation* hash_create_hmac(const VaultImplementation* vault, const has
     uint16_t secretLength = vaultImpl->Size(secret_id, true);
     if (secretLength == 0) {
         TRACE_L1("Failed to retrieve secret id 0x%08x", secret_id);
+        Implementation::RevokeKeyedContexts(vaultImpl, secret_id);
     } else {
         const EVP_MD* md = Implementation::Algorithm(type);
         if (md != nullptr) {
@@ -265,4 +584,51 @@ uint8_t hash_calculate(HashImplementation* hash, const uint8_t max_length, uint8
     return (hash->Calculate(max_length, data));
 }
 
+uint32_t hash_calculate_batch(const hash_type type, const uint32_t count, const uint32_t lengths[], const uint8_t* const data[],
+    const uint32_t max_length, uint8_t digests[])
+{
+    uint32_t result = 0;
+
+    ASSERT((count == 0) || ((lengths != nullptr) && (data != nullptr) && (digests != nullptr)));
+
+    if ((static_cast<uint64_t>(count) * type) > max_length) {
+        TRACE_L1("Output buffer to small, need %i bytes, got %i bytes", (count * type), max_length);
+    } else if (count != 0) {
+        result = Implementation::Batch::Calculate(type, nullptr, 0, count, lengths, data, digests);
+    }
+
+    return (result);
+}
+
+uint32_t hash_calculate_hmac_batch(const VaultImplementation* vault, const hash_type type, const uint32_t secret_id,
+    const uint32_t count, const uint32_t lengths[], const uint8_t* const data[], const uint32_t max_length, uint8_t digests[])
+{
+    ASSERT(vault != nullptr);
+    ASSERT((count == 0) || ((lengths != nullptr) && (data != nullptr) && (digests != nullptr)));
+
+    const Implementation::Vault *vaultImpl = reinterpret_cast<const Implementation::Vault*>(vault);
+    uint32_t result = 0;
+
+    uint16_t secretLength = vaultImpl->Size(secret_id, true);
+    if (secretLength == 0) {
+        TRACE_L1("Failed to retrieve secret id 0x%08x", secret_id);
+    } else if ((static_cast<uint64_t>(count) * type) > max_length) {
+        TRACE_L1("Output buffer to small, need %i bytes, got %i bytes", (count * type), max_length);
+    } else if (count != 0) {
+        uint8_t* secret = reinterpret_cast<uint8_t*>(ALLOCA(secretLength));
+        ASSERT(secret != nullptr);
+
+        uint16_t secretLen = vaultImpl->Export(secret_id, secretLength, secret, true);
+        ASSERT(secretLen != 0);
+
+        if (secretLen != 0) {
+            result = Implementation::Batch::Calculate(type, secret, secretLen, count, lengths, data, digests);
+        }
+
+        ::memset(secret, 0x00, secretLength);
+    }
+
+    return (result);
+}
+
 } // extern "C"
@@ -0,0 +1,294 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 Metrological
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// Deliberately free of Module.h: the lane translation units are built with extra instruction sets and must
+// not pull in (and emit) any inline or template code that is shared with the rest of the library.
+#include <stdint.h>
+#include <string.h>
+
+namespace Implementation {
+
+namespace MultiBuffer {
+
+// SHA-256 over independent messages, each SIMD lane hashes its own message.
+// Every message starts from the given initial state with `prefix` bytes already hashed (a keyed HMAC state
+// is 64 bytes in), digest i is written to digests + (i * 32).
+typedef void (*SHA256Engine)(const uint32_t initial[8], const uint64_t prefix, const uint32_t count,
+    const uint32_t lengths[], const uint8_t* const data[], uint8_t digests[]);
+
+#if defined(HASH_MULTIBUFFER_AVX2)
+void SHA256AVX2(const uint32_t initial[8], const uint64_t prefix, const uint32_t count,
+    const uint32_t lengths[], const uint8_t* const data[], uint8_t digests[]);
+#endif
+
+#if defined(__ARM_NEON)
+void SHA256NEON(const uint32_t initial[8], const uint64_t prefix, const uint32_t count,
+    const uint32_t lengths[], const uint8_t* const data[], uint8_t digests[]);
+#endif
+
+// Everything below has internal linkage on purpose: the lane code is built with different instruction sets
+// per translation unit and must never be shared between them by the linker.
+namespace {
+
+    constexpr uint8_t BlockSize = 64;
+    constexpr uint8_t DigestSize = 32;
+
+    constexpr uint32_t InitialState[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    constexpr uint32_t RoundConstants[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    // One lane, used for the keyed HMAC states and as the reference for the vector lanes.
+    struct Scalar {
+        typedef uint32_t Type;
+        static constexpr uint8_t Lanes = 1;
+
+        static Type Load(const uint32_t value[]) { return (value[0]); }
+        static void Store(uint32_t value[], const Type x) { value[0] = x; }
+        static Type Broadcast(const uint32_t value) { return (value); }
+        static Type Add(const Type x, const Type y) { return (x + y); }
+        static Type Xor(const Type x, const Type y) { return (x ^ y); }
+        static Type And(const Type x, const Type y) { return (x & y); }
+        static Type Or(const Type x, const Type y) { return (x | y); }
+        static Type AndNot(const Type x, const Type y) { return ((~x) & y); }
+        template <uint8_t N> static Type Shr(const Type x) { return (x >> N); }
+        template <uint8_t N> static Type Rotr(const Type x) { return ((x >> N) | (x << (32 - N))); }
+    };
+
+    template <typename LANES>
+    struct Functions {
+        typedef typename LANES::Type Type;
+
+        static Type Sigma0(const Type x)
+        {
+            return (LANES::Xor(LANES::Xor(LANES::template Rotr<2>(x), LANES::template Rotr<13>(x)), LANES::template Rotr<22>(x)));
+        }
+        static Type Sigma1(const Type x)
+        {
+            return (LANES::Xor(LANES::Xor(LANES::template Rotr<6>(x), LANES::template Rotr<11>(x)), LANES::template Rotr<25>(x)));
+        }
+        static Type Gamma0(const Type x)
+        {
+            return (LANES::Xor(LANES::Xor(LANES::template Rotr<7>(x), LANES::template Rotr<18>(x)), LANES::template Shr<3>(x)));
+        }
+        static Type Gamma1(const Type x)
+        {
+            return (LANES::Xor(LANES::Xor(LANES::template Rotr<17>(x), LANES::template Rotr<19>(x)), LANES::template Shr<10>(x)));
+        }
+        static Type Choose(const Type x, const Type y, const Type z)
+        {
+            return (LANES::Xor(LANES::And(x, y), LANES::AndNot(x, z)));
+        }
+        static Type Majority(const Type x, const Type y, const Type z)
+        {
+            return (LANES::Or(LANES::And(x, y), LANES::And(z, LANES::Or(x, y))));
+        }
+    };
+
+    template <typename LANES>
+    void Compress(typename LANES::Type state[8], typename LANES::Type w[16])
+    {
+        typedef typename LANES::Type Type;
+        typedef Functions<LANES> F;
+
+        Type a = state[0], b = state[1], c = state[2], d = state[3];
+        Type e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (uint8_t t = 0; t < 64; t++) {
+            if (t >= 16) {
+                // w[t] = w[t - 16] + gamma0(w[t - 15]) + w[t - 7] + gamma1(w[t - 2])
+                w[t & 15] = LANES::Add(LANES::Add(w[t & 15], F::Gamma0(w[(t + 1) & 15])),
+                                       LANES::Add(w[(t + 9) & 15], F::Gamma1(w[(t + 14) & 15])));
+            }
+
+            const Type t1 = LANES::Add(LANES::Add(LANES::Add(h, F::Sigma1(e)), LANES::Add(F::Choose(e, f, g), LANES::Broadcast(RoundConstants[t]))), w[t & 15]);
+            const Type t2 = LANES::Add(F::Sigma0(a), F::Majority(a, b, c));
+
+            h = g;
+            g = f;
+            f = e;
+            e = LANES::Add(d, t1);
+            d = c;
+            c = b;
+            b = a;
+            a = LANES::Add(t1, t2);
+        }
+
+        state[0] = LANES::Add(state[0], a);
+        state[1] = LANES::Add(state[1], b);
+        state[2] = LANES::Add(state[2], c);
+        state[3] = LANES::Add(state[3], d);
+        state[4] = LANES::Add(state[4], e);
+        state[5] = LANES::Add(state[5], f);
+        state[6] = LANES::Add(state[6], g);
+        state[7] = LANES::Add(state[7], h);
+    }
+
+    inline uint32_t BigEndian32(const uint8_t data[])
+    {
+        return ((static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16)
+            | (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]));
+    }
+
+    inline void BigEndian32(const uint32_t value, uint8_t data[])
+    {
+        data[0] = static_cast<uint8_t>(value >> 24);
+        data[1] = static_cast<uint8_t>(value >> 16);
+        data[2] = static_cast<uint8_t>(value >> 8);
+        data[3] = static_cast<uint8_t>(value);
+    }
+
+    template <typename LANES>
+    void Digest(const uint32_t initial[8], const uint64_t prefix, const uint32_t count,
+        const uint32_t lengths[], const uint8_t* const data[], uint8_t digests[])
+    {
+        typedef typename LANES::Type Type;
+
+        struct Lane {
+            uint32_t message;
+            uint64_t block;
+            uint64_t blocks; // 0 for an idle lane
+            uint8_t tail[BlockSize];
+        };
+
+        Lane lanes[LANES::Lanes];
+        alignas(32) uint32_t state[8][LANES::Lanes];
+        alignas(32) uint32_t words[16][LANES::Lanes];
+        uint32_t next = 0;
+        uint8_t active = 0;
+
+        // Hand the next message to a lane as soon as it finished the previous one, so lanes stay busy
+        // even if the message lengths differ.
+        auto assign = [&](const uint8_t index) -> bool {
+            Lane& lane = lanes[index];
+
+            if (next < count) {
+                lane.message = next++;
+                lane.block = 0;
+                lane.blocks = ((static_cast<uint64_t>(lengths[lane.message]) + 9 + (BlockSize - 1)) / BlockSize);
+
+                for (uint8_t i = 0; i < 8; i++) {
+                    state[i][index] = initial[i];
+                }
+            } else {
+                lane.blocks = 0;
+            }
+
+            return (lane.blocks != 0);
+        };
+
+        // The data itself for all full blocks, the padded tail for the last one or two.
+        auto block = [&](Lane& lane) -> const uint8_t* {
+            const uint64_t length = lengths[lane.message];
+            const uint64_t offset = (lane.block * BlockSize);
+            const uint8_t* result = (data[lane.message] + offset);
+
+            if ((offset + BlockSize) > length) {
+                ::memset(lane.tail, 0, sizeof(lane.tail));
+
+                if (offset < length) {
+                    ::memcpy(lane.tail, result, static_cast<size_t>(length - offset));
+                }
+                if (offset <= length) {
+                    lane.tail[length - offset] = 0x80;
+                }
+                if ((lane.block + 1) == lane.blocks) {
+                    const uint64_t bits = ((prefix + length) * 8);
+                    BigEndian32(static_cast<uint32_t>(bits >> 32), &lane.tail[BlockSize - 8]);
+                    BigEndian32(static_cast<uint32_t>(bits), &lane.tail[BlockSize - 4]);
+                }
+
+                result = lane.tail;
+            }
+
+            return (result);
+        };
+
+        for (uint8_t l = 0; l < LANES::Lanes; l++) {
+            if (assign(l) == true) {
+                active++;
+            }
+        }
+
+        while (active > 0) {
+            for (uint8_t l = 0; l < LANES::Lanes; l++) {
+                if (lanes[l].blocks != 0) {
+                    const uint8_t* input = block(lanes[l]);
+
+                    for (uint8_t t = 0; t < 16; t++) {
+                        words[t][l] = BigEndian32(&input[t * 4]);
+                    }
+                } else {
+                    for (uint8_t t = 0; t < 16; t++) {
+                        words[t][l] = 0;
+                    }
+                }
+            }
+
+            Type s[8];
+            Type w[16];
+
+            for (uint8_t i = 0; i < 8; i++) {
+                s[i] = LANES::Load(state[i]);
+            }
+            for (uint8_t t = 0; t < 16; t++) {
+                w[t] = LANES::Load(words[t]);
+            }
+
+            Compress<LANES>(s, w);
+
+            for (uint8_t i = 0; i < 8; i++) {
+                LANES::Store(state[i], s[i]);
+            }
+
+            for (uint8_t l = 0; l < LANES::Lanes; l++) {
+                Lane& lane = lanes[l];
+
+                if ((lane.blocks != 0) && (++lane.block == lane.blocks)) {
+                    uint8_t* digest = (digests + (static_cast<size_t>(lane.message) * DigestSize));
+
+                    for (uint8_t i = 0; i < 8; i++) {
+                        BigEndian32(state[i][l], &digest[i * 4]);
+                    }
+
+                    if (assign(l) == false) {
+                        active--;
+                    }
+                }
+            }
+        }
+    }
+
+} // namespace
+
+} // namespace MultiBuffer
+
+} // namespace Implementation
@@ -0,0 +1,61 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 Metrological
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MultiBuffer.h"
+
+#if defined(HASH_MULTIBUFFER_AVX2)
+
+#include <immintrin.h>
+
+namespace Implementation {
+
+namespace MultiBuffer {
+
+namespace {
+
+    // Eight lanes, this file is built with AVX2 enabled and only called after a runtime CPU check.
+    struct AVX2 {
+        typedef __m256i Type;
+        static constexpr uint8_t Lanes = 8;
+
+        static Type Load(const uint32_t value[]) { return (_mm256_load_si256(reinterpret_cast<const __m256i*>(value))); }
+        static void Store(uint32_t value[], const Type x) { _mm256_store_si256(reinterpret_cast<__m256i*>(value), x); }
+        static Type Broadcast(const uint32_t value) { return (_mm256_set1_epi32(static_cast<int>(value))); }
+        static Type Add(const Type x, const Type y) { return (_mm256_add_epi32(x, y)); }
+        static Type Xor(const Type x, const Type y) { return (_mm256_xor_si256(x, y)); }
+        static Type And(const Type x, const Type y) { return (_mm256_and_si256(x, y)); }
+        static Type Or(const Type x, const Type y) { return (_mm256_or_si256(x, y)); }
+        static Type AndNot(const Type x, const Type y) { return (_mm256_andnot_si256(x, y)); }
+        template <uint8_t N> static Type Shr(const Type x) { return (_mm256_srli_epi32(x, N)); }
+        template <uint8_t N> static Type Rotr(const Type x) { return (_mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, (32 - N)))); }
+    };
+
+} // namespace
+
+void SHA256AVX2(const uint32_t initial[8], const uint64_t prefix, const uint32_t count,
+    const uint32_t lengths[], const uint8_t* const data[], uint8_t digests[])
+{
+    Digest<AVX2>(initial, prefix, count, lengths, data, digests);
+}
+
+} // namespace MultiBuffer
+
+} // namespace Implementation
+
+#endif // HASH_MULTIBUFFER_AVX2
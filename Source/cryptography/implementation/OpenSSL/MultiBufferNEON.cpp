@@ -0,0 +1,61 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 Metrological
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MultiBuffer.h"
+
+#if defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+namespace Implementation {
+
+namespace MultiBuffer {
+
+namespace {
+
+    // Four lanes, NEON is part of the baseline wherever this gets built.
+    struct NEON {
+        typedef uint32x4_t Type;
+        static constexpr uint8_t Lanes = 4;
+
+        static Type Load(const uint32_t value[]) { return (vld1q_u32(value)); }
+        static void Store(uint32_t value[], const Type x) { vst1q_u32(value, x); }
+        static Type Broadcast(const uint32_t value) { return (vdupq_n_u32(value)); }
+        static Type Add(const Type x, const Type y) { return (vaddq_u32(x, y)); }
+        static Type Xor(const Type x, const Type y) { return (veorq_u32(x, y)); }
+        static Type And(const Type x, const Type y) { return (vandq_u32(x, y)); }
+        static Type Or(const Type x, const Type y) { return (vorrq_u32(x, y)); }
+        static Type AndNot(const Type x, const Type y) { return (vbicq_u32(y, x)); }
+        template <uint8_t N> static Type Shr(const Type x) { return (vshrq_n_u32(x, N)); }
+        template <uint8_t N> static Type Rotr(const Type x) { return (vorrq_u32(vshrq_n_u32(x, N), vshlq_n_u32(x, (32 - N)))); }
+    };
+
+} // namespace
+
+void SHA256NEON(const uint32_t initial[8], const uint64_t prefix, const uint32_t count,
+    const uint32_t lengths[], const uint8_t* const data[], uint8_t digests[])
+{
+    Digest<NEON>(initial, prefix, count, lengths, data, digests);
+}
+
+} // namespace MultiBuffer
+
+} // namespace Implementation
+
+#endif // __ARM_NEON
@@ -35,6 +35,7 @@ using namespace Thunder;
 #include <openssl/rand.h>
 
 #include "Derive.h"
+#include "Hash.h"
 #include "Vault.h"
 
 namespace Implementation {
@@ -224,8 +225,19 @@ Vault::Vault(const string key, const Callback& ctor, const Callback& dtor)
     , _items()
     , _lastHandle(0)
     , _vaultKey(key)
+    , _context(EVP_CIPHER_CTX_new())
     , _dtor(dtor)
 {
+    ASSERT(_context != nullptr);
+
+    // The vault key schedule is set up once, every blob only sets its own IV.
+    // AES-CTR uses the encryption key schedule for both directions.
+    if (EVP_CipherInit_ex(_context, EVP_aes_128_ctr(), nullptr, reinterpret_cast<const unsigned char*>(_vaultKey.data()), nullptr, 1) == 0) {
+        TRACE_L1("Failed to set up the vault key");
+        EVP_CIPHER_CTX_free(_context);
+        _context = nullptr;
+    }
+
     if (ctor != nullptr) {
         ctor(*this);
     }
@@ -238,6 +250,10 @@ Vault::~Vault()
     if (_dtor != nullptr) {
         _dtor(*this);
     }
+
+    if (_context != nullptr) {
+        EVP_CIPHER_CTX_free(_context);
+    }
 }
 
 uint16_t Vault::Cipher(bool encrypt, const uint16_t inSize, const uint8_t input[], const uint16_t maxOutSize, uint8_t output[]) const
@@ -269,30 +285,25 @@ uint16_t Vault::Cipher(bool encrypt, const uint16_t inSize, const uint8_t input[
             outputBuffer = output;
         }
 
-        EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-        ASSERT(ctx != nullptr);
+        _lock.Lock();
 
         // AES-CTR ensures same buffer size after encryption
-        if (EVP_CipherInit_ex(ctx, EVP_aes_128_ctr(), nullptr, reinterpret_cast<const unsigned char*>(_vaultKey.data()), iv, encrypt) != 0) {
+        if ((_context != nullptr) && (EVP_CipherInit_ex(_context, nullptr, nullptr, nullptr, iv, encrypt) != 0)) {
 
             int outLen = 0;
 
-            if (EVP_CipherUpdate(ctx, outputBuffer, &outLen, inputBuffer, inputSize) != 0) {
+            if (EVP_CipherUpdate(_context, outputBuffer, &outLen, inputBuffer, inputSize) != 0) {
                 totalLen += outLen;
                 outLen = 0;
 
-                if (EVP_CipherFinal_ex(ctx, (outputBuffer + totalLen), &outLen) != 0) {
+                if (EVP_CipherFinal_ex(_context, (outputBuffer + totalLen), &outLen) != 0) {
                     totalLen += outLen;
                     result = totalLen;
                 }
             }
         }
 
-#if OPENSSL_VERSION_NUMBER >= 0x10100000L
-        EVP_CIPHER_CTX_reset(ctx);
-#else
-        EVP_CIPHER_CTX_cleanup(ctx);
-#endif
+        _lock.Unlock();
     }
 
     return (result);
@@ -446,6 +457,11 @@ bool Vault::Delete(const uint32_t id)
     }
     _lock.Unlock();
 
+    if (result == true) {
+        // HMAC contexts keyed with this secret must not outlive it.
+        RevokeKeyedContexts(this, id);
+    }
+
     return (result);
 }
 
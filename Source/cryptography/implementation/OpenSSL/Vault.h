@@ -21,6 +21,7 @@
 #include <map>
 #include <climits>
 
+struct evp_cipher_ctx_st;
 
 namespace Implementation {
 
@@ -81,6 +82,7 @@ private:
     std::map<uint32_t, Element> _items;
     uint32_t _lastHandle;
     string _vaultKey;
+    struct evp_cipher_ctx_st* _context;
     Callback _dtor;
 };
 
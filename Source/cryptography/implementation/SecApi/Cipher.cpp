@@ -36,6 +36,8 @@ namespace Implementation {
         , _keyLength(keyLength)
         , _ivLength(ivLength)
         , _algorithm(algorithm)
+        , _streamKey(nullptr)
+        , _streamCipher(nullptr)
     {
 
         ASSERT(vault != nullptr);
@@ -48,7 +50,7 @@ namespace Implementation {
     /* DOTR */
     Cipher::~Cipher()
     {
-
+        Close();
     }
 
     /*********************************************************************
@@ -189,6 +191,153 @@ namespace Implementation {
 
     }
 
+    /*********************************************************************
+     * @function Function Init
+     *
+     * @brief   brief Used to start a streaming encryption or decryption
+     *
+     * @param[in] encrypt - mode :true for enc and false for decrypt
+     * @param[in] ivLength - Length of the iv value
+     * @param[in] iv - intitialization vector
+     *
+     * @return true if the cipher handle for the stream is created
+     *
+     *********************************************************************/
+    bool Cipher::Init(const bool encrypt, const uint8_t ivLength, const uint8_t iv[])
+    {
+        bool result = false;
+        ASSERT(iv != nullptr);
+
+        Close();
+
+        if (ivLength != _ivLength) {
+            TRACE_L1(_T("SEC: Invalid IV length! [%i]"), ivLength);
+        }
+        else if (_vault->getSecProcHandle() == nullptr) {
+            TRACE_L1(_T("SEC: Unable to have a valid secproc handle from vault \n"));
+        }
+        else {
+            IdStore* ids;
+
+            uint8_t* keyBuf = reinterpret_cast<uint8_t*>(ALLOCA(sizeof(ids)));
+            ASSERT(keyBuf != nullptr);
+
+            uint16_t length = _vault->Export(_keyId, _keyLength, keyBuf, true);
+            if (length != _keyLength) {
+                TRACE_L1(_T("SEC: Failed to retrieve a valid encryption key from id 0x%08x"), _keyId);
+            }
+            else {
+                std::memcpy(&ids, keyBuf, sizeof(ids));
+                ASSERT(ids->idAes != 0);
+
+                Sec_Result sec_res = SecKey_GetInstance(_vault->getSecProcHandle(), ids->idAes, &_streamKey);
+                if ((sec_res != SEC_RESULT_SUCCESS) || (_streamKey == nullptr)) {
+                    TRACE_L1(_T("SEC: Key instance failed ,retVal = %d \n"), sec_res);
+                    _streamKey = nullptr;
+                }
+                else {
+                    SEC_BYTE* iv_data = const_cast<SEC_BYTE*>(iv);
+                    sec_res = SecCipher_GetInstance(_vault->getSecProcHandle(), _algorithm, (encrypt ? SEC_CIPHERMODE_ENCRYPT : SEC_CIPHERMODE_DECRYPT),
+                                                    _streamKey, iv_data, &_streamCipher);
+                    if ((sec_res != SEC_RESULT_SUCCESS) || (_streamCipher == nullptr)) {
+                        TRACE_L1(_T("SEC:cipher handle not created retVal = %d \n"), sec_res);
+                        _streamCipher = nullptr;
+                        Close();
+                    }
+                    else {
+                        result = true;
+                    }
+                }
+            }
+        }
+
+        return (result);
+    }
+
+    /*********************************************************************
+     * @function Function Update
+     *
+     * @brief   brief Used to encrypt/decrypt the next chunk of a stream
+     *
+     * @param[in] inputLength - Length of input chunk
+     * @param[in] input - input chunk of data
+     * @param[in] maxOutputLength - max possible length of output buffer
+     * @param[out] output - Processed output buffer
+     *
+     * @return Length of the bytesWritten, negative on failure
+     *
+     *********************************************************************/
+    int32_t Cipher::Update(const uint32_t inputLength, const uint8_t input[],
+        const uint32_t maxOutputLength, uint8_t output[])
+    {
+        int32_t result = -1;
+        ASSERT(input != nullptr);
+        ASSERT(inputLength != 0);
+
+        if (_streamCipher == nullptr) {
+            TRACE_L1(_T("SEC: No cipher stream in progress"));
+        }
+        else {
+            SEC_SIZE OutputLength = 0;
+            SEC_BYTE* input_data = const_cast<SEC_BYTE*>(input);
+            Sec_Result sec_res = SecCipher_Process(_streamCipher, input_data, inputLength, SEC_FALSE, output, maxOutputLength, &OutputLength);
+            if (sec_res != SEC_RESULT_SUCCESS) {
+                TRACE_L1(_T("SEC SecCipher_Process failed retVal = %d \n"), sec_res);
+                Close();
+            }
+            else {
+                result = static_cast<int32_t>(OutputLength);
+            }
+        }
+
+        return (result);
+    }
+
+    /*********************************************************************
+     * @function Function Final
+     *
+     * @brief   brief Used to complete a stream and release its handles
+     *
+     * @param[in] maxOutputLength - max possible length of output buffer
+     * @param[out] output - Processed output buffer
+     *
+     * @return Length of the bytesWritten, negative on failure
+     *
+     *********************************************************************/
+    int32_t Cipher::Final(const uint32_t maxOutputLength, uint8_t output[])
+    {
+        int32_t result = -1;
+
+        if (_streamCipher == nullptr) {
+            TRACE_L1(_T("SEC: No cipher stream in progress"));
+        }
+        else {
+            SEC_SIZE OutputLength = 0;
+            Sec_Result sec_res = SecCipher_Process(_streamCipher, nullptr, 0, SEC_TRUE, output, maxOutputLength, &OutputLength);
+            if (sec_res != SEC_RESULT_SUCCESS) {
+                TRACE_L1(_T("SEC SecCipher_Process failed retVal = %d \n"), sec_res);
+            }
+            else {
+                result = static_cast<int32_t>(OutputLength);
+            }
+            Close();
+        }
+
+        return (result);
+    }
+
+    void Cipher::Close()
+    {
+        if (_streamCipher != nullptr) {
+            SecCipher_Release(_streamCipher);
+            _streamCipher = nullptr;
+        }
+        if (_streamKey != nullptr) {
+            SecKey_Release(_streamKey);
+            _streamKey = nullptr;
+        }
+    }
+
     /*********************************************************************
      * @function AESCipher
      *
@@ -288,6 +437,25 @@ extern "C" {
         return (cipher->Decrypt(iv_length, iv, input_length, input, max_output_length, output));
     }
 
+    bool cipher_init(struct CipherImplementation* cipher, const bool encrypt, const uint8_t iv_length, const uint8_t iv[])
+    {
+        ASSERT(cipher != nullptr);
+        return (cipher->Init(encrypt, iv_length, iv));
+    }
+
+    int32_t cipher_update(struct CipherImplementation* cipher,
+        const uint32_t input_length, const uint8_t input[], const uint32_t max_output_length, uint8_t output[])
+    {
+        ASSERT(cipher != nullptr);
+        return (cipher->Update(input_length, input, max_output_length, output));
+    }
+
+    int32_t cipher_final(struct CipherImplementation* cipher, const uint32_t max_output_length, uint8_t output[])
+    {
+        ASSERT(cipher != nullptr);
+        return (cipher->Final(max_output_length, output));
+    }
+
 
 } // extern "C"
 
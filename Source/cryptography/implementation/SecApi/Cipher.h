@@ -36,6 +36,24 @@ struct CipherImplementation {
     virtual int32_t Decrypt(const uint8_t ivLength, const uint8_t iv[], const uint32_t inputLength,
         const uint8_t input[], const uint32_t maxOutputLength, uint8_t output[]) const = 0;
 
+    // Streaming is optional, ciphers that can not do it fail the initialization.
+    virtual bool Init(const bool encrypt VARIABLE_IS_NOT_USED, const uint8_t ivLength VARIABLE_IS_NOT_USED, const uint8_t iv[] VARIABLE_IS_NOT_USED)
+    {
+        TRACE_L1(_T("SEC: Streaming is not supported by this cipher"));
+        return (false);
+    }
+
+    virtual int32_t Update(const uint32_t inputLength VARIABLE_IS_NOT_USED, const uint8_t input[] VARIABLE_IS_NOT_USED,
+        const uint32_t maxOutputLength VARIABLE_IS_NOT_USED, uint8_t output[] VARIABLE_IS_NOT_USED)
+    {
+        return (-1);
+    }
+
+    virtual int32_t Final(const uint32_t maxOutputLength VARIABLE_IS_NOT_USED, uint8_t output[] VARIABLE_IS_NOT_USED)
+    {
+        return (-1);
+    }
+
     virtual ~CipherImplementation() { }
 };
 
@@ -64,6 +82,17 @@ namespace Implementation {
         int32_t Decrypt(const uint8_t ivLength, const uint8_t iv[], const uint32_t inputLength,
             const uint8_t input[], const uint32_t maxOutputLength, uint8_t output[]) const override;
 
+        bool Init(const bool encrypt, const uint8_t ivLength, const uint8_t iv[]) override;
+
+        int32_t Update(const uint32_t inputLength, const uint8_t input[],
+            const uint32_t maxOutputLength, uint8_t output[]) override;
+
+        int32_t Final(const uint32_t maxOutputLength, uint8_t output[]) override;
+
+    private:
+
+        void Close();
+
     private:
 
         const Implementation::Vault* _vault;
@@ -71,6 +100,8 @@ namespace Implementation {
         uint8_t _keyLength;
         uint8_t _ivLength;
         const Sec_CipherAlgorithm _algorithm;
+        Sec_KeyHandle* _streamKey;
+        Sec_CipherHandle* _streamCipher;
 
     };
 
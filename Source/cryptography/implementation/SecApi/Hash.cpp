@@ -372,5 +372,62 @@ extern "C" {
         return (hash->Calculate(max_length, data));
     }
 
+    // SecApi offers no multi-buffer hashing, the batch calls run the messages one after the other.
+    static uint32_t hash_batch(HashImplementation* (*create)(const void*), const void* context, const hash_type type,
+        const uint32_t count, const uint32_t lengths[], const uint8_t* const data[], const uint32_t max_length, uint8_t digests[])
+    {
+        uint32_t result = 0;
+
+        if ((static_cast<uint64_t>(count) * type) > max_length) {
+            TRACE_L1(_T("SEC: Output buffer to small, need %i bytes, got %i bytes"), (count * type), max_length);
+        }
+        else {
+            result = count;
+
+            for (uint32_t i = 0; (i < count) && (result != 0); i++) {
+                HashImplementation* hash = create(context);
+
+                if ((hash == nullptr) || (hash->Ingest(lengths[i], data[i]) != lengths[i])
+                    || (hash->Calculate(type, (digests + (static_cast<size_t>(i) * type))) != type)) {
+                    TRACE_L1(_T("SEC: Batch hash %i of %i failed"), i, count);
+                    result = 0;
+                }
+
+                if (hash != nullptr) {
+                    delete hash;
+                }
+            }
+        }
+
+        return (result);
+    }
+
+    uint32_t hash_calculate_batch(const hash_type type, const uint32_t count, const uint32_t lengths[], const uint8_t* const data[],
+        const uint32_t max_length, uint8_t digests[])
+    {
+        auto create = [](const void* context) -> HashImplementation* {
+            return (hash_create(*static_cast<const hash_type*>(context)));
+        };
+
+        return (hash_batch(create, &type, type, count, lengths, data, max_length, digests));
+    }
+
+    uint32_t hash_calculate_hmac_batch(const VaultImplementation* vault, const hash_type type, const uint32_t secret_id,
+        const uint32_t count, const uint32_t lengths[], const uint8_t* const data[], const uint32_t max_length, uint8_t digests[])
+    {
+        struct Context {
+            const VaultImplementation* vault;
+            hash_type type;
+            uint32_t secret_id;
+        } context = { vault, type, secret_id };
+
+        auto create = [](const void* context) -> HashImplementation* {
+            const Context* hmac = static_cast<const Context*>(context);
+            return (hash_create_hmac(hmac->vault, hmac->type, hmac->secret_id));
+        };
+
+        return (hash_batch(create, &context, type, count, lengths, data, max_length, digests));
+    }
+
 } // extern "C"
 
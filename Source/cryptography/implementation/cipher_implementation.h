@@ -21,6 +21,7 @@
 #define CIPHER_IMPLEMENTATION_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "vault_implementation.h"
 
 #ifdef __cplusplus
@@ -50,6 +51,19 @@ EXTERNAL int32_t cipher_encrypt(const struct CipherImplementation* cipher, const
 EXTERNAL int32_t cipher_decrypt(const struct CipherImplementation* cipher, const uint8_t iv_length, const uint8_t iv[],
                         const uint32_t input_length, const uint8_t input[], const uint32_t max_output_length, uint8_t output[]);
 
+/* Streaming operation, for payloads that are processed in chunks rather than in one go.
+ * cipher_init() starts an encryption or decryption with the given IV, cipher_update() is then called for every chunk
+ * and cipher_final() completes the operation (and writes out the padding, if any).
+ * Both cipher_update() and cipher_final() return the number of bytes written to output, or a negative value on failure;
+ * for a too small output buffer that is the negated required size. As a block may be held back until the next call,
+ * the output buffer of cipher_update() must have room for the input length plus one cipher block. */
+EXTERNAL bool cipher_init(struct CipherImplementation* cipher, const bool encrypt, const uint8_t iv_length, const uint8_t iv[]);
+
+EXTERNAL int32_t cipher_update(struct CipherImplementation* cipher,
+                        const uint32_t input_length, const uint8_t input[], const uint32_t max_output_length, uint8_t output[]);
+
+EXTERNAL int32_t cipher_final(struct CipherImplementation* cipher, const uint32_t max_output_length, uint8_t output[]);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -48,6 +48,16 @@ EXTERNAL uint32_t hash_ingest(struct HashImplementation* signing, const uint32_t
 
 EXTERNAL uint8_t hash_calculate(struct HashImplementation* signing, const uint8_t max_length, uint8_t data[]);
 
+/* Batch calculation of independent digests, one per message (data[i] of lengths[i] bytes).
+ * Digest i is written to digests + (i * type), so max_length must be at least count * type.
+ * Returns the number of digests calculated, which is either count or 0 on failure. */
+EXTERNAL uint32_t hash_calculate_batch(const hash_type type, const uint32_t count, const uint32_t lengths[], const uint8_t* const data[],
+                                       const uint32_t max_length, uint8_t digests[]);
+
+EXTERNAL uint32_t hash_calculate_hmac_batch(const struct VaultImplementation* vault, const hash_type type, const uint32_t secret_id,
+                                            const uint32_t count, const uint32_t lengths[], const uint8_t* const data[],
+                                            const uint32_t max_length, uint8_t digests[]);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -26,6 +26,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include <limits.h>
+#include <chrono>
 
 #include <openssl/dh.h>
 #include <openssl/hmac.h>
@@ -370,11 +371,119 @@ TEST(Signing, HMAC)
                                         0xEC, 0x47, 0x89, 0x62, 0x89, 0xBF, 0x25, 0x0D, 0x1B, 0x11, 0x28, 0xA6,
                                         0x48, 0xD5, 0x77, 0xF2 };
         TestHMAC("SHA512", HASH_TYPE_SHA512, secret, data, (sizeof(data) - 1), hash_sha512, sizeof(hash_sha512));
+
+        // Keyed contexts are reused between HMACs, but never after the secret is gone.
+        EXPECT_NE(vault_delete(vault, secret), false);
+        struct HashImplementation* hash = hash_create_hmac(vault, HASH_TYPE_SHA256, secret);
+        EXPECT_EQ((hash == NULL), true);
+        if (hash != NULL) {
+            hash_destroy(hash);
+        }
     } else {
         printf("FATAL: Failed to store secret into vault, HMAC tests are skipped\n");
     }
 }
 
+static uint32_t SequentialHash(const hash_type type, const uint32_t secret, const uint32_t count,
+                               const uint32_t lengths[], const uint8_t* const data[], uint8_t digests[])
+{
+    uint32_t result = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        struct HashImplementation* hash = (secret != 0 ? hash_create_hmac(vault, type, secret) : hash_create(type));
+
+        if (hash != NULL) {
+            hash_ingest(hash, lengths[i], data[i]);
+            result += (hash_calculate(hash, type, (digests + (i * type))) == type ? 1 : 0);
+            hash_destroy(hash);
+        }
+    }
+
+    return (result);
+}
+
+static void TestHashBatch(const char *name, const hash_type type, const uint32_t secret, const uint32_t count,
+                          const uint32_t lengths[], const uint8_t* const data[])
+{
+    printf("> Testing %s batch %s\n", (secret != 0 ? "HMAC" : "hash"), name);
+
+    uint8_t* batch = static_cast<uint8_t*>(malloc(count * type));
+    uint8_t* sequential = static_cast<uint8_t*>(malloc(count * type));
+
+    memset(batch, 0, count * type);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    if (secret != 0) {
+        EXPECT_EQ(hash_calculate_hmac_batch(vault, type, secret, count, lengths, data, (count * type) - 1, batch), 0);
+        EXPECT_EQ(hash_calculate_hmac_batch(vault, type, secret, count, lengths, data, (count * type), batch), count);
+    } else {
+        EXPECT_EQ(hash_calculate_batch(type, count, lengths, data, (count * type) - 1, batch), 0);
+        EXPECT_EQ(hash_calculate_batch(type, count, lengths, data, (count * type), batch), count);
+    }
+
+    std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+
+    EXPECT_EQ(SequentialHash(type, secret, count, lengths, data, sequential), count);
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    EXPECT_EQ(memcmp(batch, sequential, count * type), 0);
+
+    printf("  %i messages: batch %lld us, sequential contexts %lld us\n", count,
+        static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(middle - start).count()),
+        static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(end - middle).count()));
+
+    free(sequential);
+    free(batch);
+}
+
+TEST(Signing, Batch)
+{
+    // Lengths around the block boundaries and uneven, so lanes finish at different times.
+    const uint32_t count = 515;
+    uint32_t* lengths = static_cast<uint32_t*>(malloc(count * sizeof(uint32_t)));
+    const uint8_t** data = static_cast<const uint8_t**>(malloc(count * sizeof(uint8_t*)));
+    uint8_t* buffer = static_cast<uint8_t*>(malloc(count * 3));
+
+    for (uint32_t i = 0; i < (count * 3); i++) {
+        buffer[i] = static_cast<uint8_t>(i * 7);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        lengths[i] = (i % 3 == 0 ? i : (i % 130));
+        data[i] = (buffer + i);
+    }
+
+    TestHashBatch("SHA256", HASH_TYPE_SHA256, 0, count, lengths, data);
+    TestHashBatch("SHA1", HASH_TYPE_SHA1, 0, count, lengths, data);
+
+    const uint8_t password[] = "Thunder";
+    uint8_t longPassword[100];
+    memset(longPassword, 0x5a, sizeof(longPassword));
+
+    uint32_t secret = vault_import(vault, (sizeof(password) - 1), password);
+    uint32_t longSecret = vault_import(vault, sizeof(longPassword), longPassword);
+
+    if ((secret != 0) && (longSecret != 0)) {
+        TestHashBatch("SHA256", HASH_TYPE_SHA256, secret, count, lengths, data);
+        TestHashBatch("SHA256 (long key)", HASH_TYPE_SHA256, longSecret, count, lengths, data);
+        TestHashBatch("SHA512", HASH_TYPE_SHA512, secret, count, lengths, data);
+    } else {
+        printf("FATAL: Failed to store secret into vault, HMAC batch tests are skipped\n");
+    }
+
+    if (secret != 0) {
+        vault_delete(vault, secret);
+    }
+    if (longSecret != 0) {
+        vault_delete(vault, longSecret);
+    }
+
+    free(buffer);
+    free(data);
+    free(lengths);
+}
+
 /*
   ===================================
     CIPHER
@@ -557,6 +666,13 @@ static void TestCryptAES(const char *name, const aes_mode mode, const uint32_t k
 
         EXPECT_NE(memcmp(input, output, MIN(expectedLength, length)), 0);
 
+        // The cipher keeps its context between calls, a second run must yield the same result.
+        uint8_t* again = static_cast<uint8_t*>(malloc(bufferSize));
+        memset(again, 0, bufferSize);
+        EXPECT_EQ(cipher_encrypt(cipher, ivLength, iv, length, data, bufferSize, again), expectedLength);
+        EXPECT_EQ(memcmp(again, output, expectedLength), 0);
+        free(again);
+
         free(input);
         free(output);
     } else {
@@ -702,6 +818,160 @@ TEST(Cipher, AES_Unpadded)
     }
 }
 
+static uint32_t StreamAES(struct CipherImplementation* cipher, const bool encrypt, const uint8_t iv[], const uint16_t ivLength,
+                          const uint8_t data[], const uint16_t length, const uint16_t chunkSize, uint8_t output[], const uint16_t bufferSize)
+{
+    uint32_t total = 0;
+
+    EXPECT_NE(cipher_init(cipher, encrypt, ivLength, iv), false);
+
+    for (uint16_t offset = 0; offset < length; offset += chunkSize) {
+        const uint16_t chunk = MIN(chunkSize, (length - offset));
+        int32_t written = cipher_update(cipher, chunk, (data + offset), (bufferSize - total), (output + total));
+        EXPECT_GE(written, 0);
+        total += (written > 0 ? written : 0);
+    }
+
+    int32_t written = cipher_final(cipher, (bufferSize - total), (output + total));
+    EXPECT_GE(written, 0);
+    total += (written > 0 ? written : 0);
+
+    return (total);
+}
+
+static void TestStreamAES(const char *name, const aes_mode mode, const uint32_t key,
+                          const uint8_t iv[], const uint16_t ivLength,
+                          const uint8_t data[], const uint16_t length, const uint16_t chunkSize, const uint16_t bufferSize)
+{
+    printf("> Testing %s streaming encryption\n", name);
+    struct CipherImplementation* cipher = cipher_create_aes(vault, mode, key);
+
+    if (cipher != NULL) {
+        uint8_t* expected = static_cast<uint8_t*>(malloc(bufferSize));
+        uint8_t* output = static_cast<uint8_t*>(malloc(bufferSize));
+        uint8_t* input = static_cast<uint8_t*>(malloc(bufferSize));
+
+        int32_t expectedLength = cipher_encrypt(cipher, ivLength, iv, length, data, bufferSize, expected);
+        EXPECT_GT(expectedLength, 0);
+
+        // Chunks that do not line up with the block size must give the same result as a one-shot operation.
+        EXPECT_EQ(StreamAES(cipher, true, iv, ivLength, data, length, chunkSize, output, bufferSize), static_cast<uint32_t>(expectedLength));
+        EXPECT_EQ(memcmp(output, expected, expectedLength), 0);
+
+        EXPECT_EQ(StreamAES(cipher, false, iv, ivLength, output, expectedLength, chunkSize, input, bufferSize), length);
+        EXPECT_EQ(memcmp(input, data, length), 0);
+
+        EXPECT_LT(cipher_update(cipher, length, data, bufferSize, output), 0);
+
+        free(input);
+        free(output);
+        free(expected);
+    } else {
+        printf("  FATAL: Failed to create cryptor implementations, streaming test %s test will be skipped\n", name);
+    }
+
+    if (cipher) {
+        cipher_destroy(cipher);
+    }
+}
+
+TEST(Cipher, AES_Streaming)
+{
+    const uint8_t data[] = "Look behind you, a Three-Headed Monkey! No, really, there is one right behind you.";
+    const uint16_t dataSize = sizeof(data) - 1;
+    const uint16_t bufferSize = dataSize + 64;
+
+    const uint8_t iv[]   =  { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+
+    const uint8_t key128[] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x11 };
+
+    uint32_t key128Id = vault_import(vault, sizeof(key128), key128);
+    EXPECT_NE(key128Id, 0);
+    if (key128Id != 0) {
+        TestStreamAES("128-bit AES/CBC", AES_MODE_CBC, key128Id, iv, sizeof(iv), data, dataSize, 7, bufferSize);
+        TestStreamAES("128-bit AES/CBC", AES_MODE_CBC, key128Id, iv, sizeof(iv), data, dataSize, 32, bufferSize);
+        TestStreamAES("128-bit AES/CTR", AES_MODE_CTR, key128Id, iv, sizeof(iv), data, dataSize, 7, bufferSize);
+        EXPECT_NE(vault_delete(vault, key128Id), false);
+        EXPECT_EQ(vault_size(vault, key128Id), 0);
+    } else {
+        printf("  FATAL: Failed to store key to vault, streaming AES tests will be skipped\n");
+    }
+}
+
+TEST(Cipher, AES_Small)
+{
+    // Many short messages on one key, as for e.g. key wrapping or message
+    // framing: the keyed cipher is set up once and only the IV changes.
+    const uint32_t count = 1000;
+    const uint16_t length = 64;
+    uint8_t data[length];
+    uint8_t iv[16];
+    uint8_t output[length + 16];
+    uint8_t reference[length + 16];
+
+    for (uint16_t i = 0; i < length; i++) {
+        data[i] = static_cast<uint8_t>(i * 13);
+    }
+
+    const uint8_t key128[] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x11 };
+
+    uint32_t key128Id = vault_import(vault, sizeof(key128), key128);
+    EXPECT_NE(key128Id, 0);
+    if (key128Id != 0) {
+        printf("> Testing 128-bit AES/CBC on small messages
+");
+
+        struct CipherImplementation* cipher = cipher_create_aes(vault, AES_MODE_CBC, key128Id);
+        EXPECT_EQ((cipher != NULL), true);
+
+        if (cipher != NULL) {
+            uint32_t reused = 0;
+            uint32_t created = 0;
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            for (uint32_t i = 0; i < count; i++) {
+                memset(iv, static_cast<uint8_t>(i), sizeof(iv));
+                reused += (cipher_encrypt(cipher, sizeof(iv), iv, length, data, sizeof(output), output) == (length + 16) ? 1 : 0);
+            }
+
+            std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+
+            for (uint32_t i = 0; i < count; i++) {
+                struct CipherImplementation* single = cipher_create_aes(vault, AES_MODE_CBC, key128Id);
+
+                if (single != NULL) {
+                    memset(iv, static_cast<uint8_t>(i), sizeof(iv));
+                    created += (cipher_encrypt(single, sizeof(iv), iv, length, data, sizeof(reference), reference) == (length + 16) ? 1 : 0);
+                    cipher_destroy(single);
+                }
+            }
+
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+            EXPECT_EQ(reused, count);
+            EXPECT_EQ(created, count);
+            // Both ended with the same IV, so with the same ciphertext.
+            EXPECT_EQ(memcmp(output, reference, sizeof(output)), 0);
+
+            printf("  %i messages of %i bytes: one cipher %lld us, cipher per message %lld us\n", count, length,
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(middle - start).count()),
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(end - middle).count()));
+
+            // The cipher keeps the key schedule, but may not use it once the key is gone.
+            EXPECT_NE(vault_delete(vault, key128Id), false);
+            EXPECT_EQ(cipher_encrypt(cipher, sizeof(iv), iv, length, data, sizeof(output), output), 0);
+            EXPECT_EQ(cipher_init(cipher, true, sizeof(iv), iv), false);
+
+            cipher_destroy(cipher);
+        } else {
+            EXPECT_NE(vault_delete(vault, key128Id), false);
+        }
+    } else {
+        printf("  FATAL: Failed to store key to vault, small message AES tests will be skipped\n");
+    }
+}
+
 /*
   ===================================
 */
@@ -718,12 +988,15 @@ int main(void)
 
         CALL(Signing, Hash);
         CALL(Signing, HMAC);
+        CALL(Signing, Batch);
 
         CALL(DH, Generate);
         CALL(DH, DeriveStandard); // Will not work on Sage
 
         CALL(Cipher, AES_Padded);
         CALL(Cipher, AES_Unpadded);
+        CALL(Cipher, AES_Streaming);
+        CALL(Cipher, AES_Small);
     }
 
     printf("TOTAL: %i tests; %i PASSED, %i FAILED\n", TotalTests, TotalTestsPassed, (TotalTests - TotalTestsPassed));
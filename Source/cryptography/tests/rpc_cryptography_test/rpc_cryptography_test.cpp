@@ -606,6 +606,51 @@ TEST_F(BasicTest, HashSHA1Calculate)
     }
 }
 
+TEST_F(BasicTest, HashSHA1CalculateSplitIngest)
+{
+    uint8_t exportBuffer[Thunder::Exchange::SHA1];
+    memset(exportBuffer, 0, sizeof(exportBuffer));
+
+    ASSERT_EQ(controller.ActivatePlugin(TestData::plugin), Thunder::Core::ERROR_NONE);
+    ASSERT_TRUE(controller.IsPluginActive(TestData::plugin));
+    ASSERT_NE(nullptr, cryptography);
+
+    Thunder::Exchange::IHash* hash = cryptography->Hash(Thunder::Exchange::SHA1);
+
+    ASSERT_NE(nullptr, hash);
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(TestData::data);
+
+    for (uint32_t offset = 0; offset < sizeof(TestData::data); offset += 3) {
+        const uint32_t length = std::min(static_cast<uint32_t>(3), static_cast<uint32_t>(sizeof(TestData::data) - offset));
+        EXPECT_EQ(hash->Ingest(length, (data + offset)), length);
+    }
+
+    EXPECT_EQ(hash->Calculate(sizeof(exportBuffer), exportBuffer), Thunder::Exchange::SHA1);
+
+    EXPECT_TRUE(ArraysMatch(exportBuffer, TestData::expectedSHA1HashOfData));
+
+    if (hash != nullptr) {
+        hash->Release();
+        hash = nullptr;
+    }
+}
+
+TEST_F(BasicTest, HashSHA1OneShot)
+{
+    uint8_t exportBuffer[Thunder::Exchange::SHA1];
+    memset(exportBuffer, 0, sizeof(exportBuffer));
+
+    ASSERT_EQ(controller.ActivatePlugin(TestData::plugin), Thunder::Core::ERROR_NONE);
+    ASSERT_TRUE(controller.IsPluginActive(TestData::plugin));
+    ASSERT_NE(nullptr, cryptography);
+
+    EXPECT_EQ(Thunder::Cryptography::Hash(cryptography, Thunder::Exchange::SHA1, sizeof(TestData::data),
+                  reinterpret_cast<const uint8_t*>(TestData::data), sizeof(exportBuffer), exportBuffer), Thunder::Exchange::SHA1);
+
+    EXPECT_TRUE(ArraysMatch(exportBuffer, TestData::expectedSHA1HashOfData));
+}
+
 TEST_F(BasicTest, HashSHA1CalculateDeactivate)
 {
     uint8_t exportBuffer[Thunder::Exchange::SHA1];
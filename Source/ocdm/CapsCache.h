@@ -0,0 +1,147 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 Metrological
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+#include "open_cdm_impl.h"
+
+#include <gst/gst.h>
+
+// Stream properties derived from the caps of the buffers decrypted on a
+// session. Caps can not change while we hold a reference to them, so as long
+// as the same caps are passed in, there is nothing to parse again. A session
+// is typically shared by an audio and a video stream, so the caps of both are
+// kept. The references are dropped when the session is destructed.
+class CapsCache : public OpenCDMSession::AdapterState {
+private:
+    static constexpr uint8_t Entries = 2;
+
+    struct Entry {
+        GstCaps* Caps;
+        MediaProperties Properties;
+    };
+
+public:
+    CapsCache(const CapsCache&) = delete;
+    CapsCache& operator=(const CapsCache&) = delete;
+
+    CapsCache()
+        : _lock()
+        , _next(0)
+    {
+        for (uint8_t index = 0; index < Entries; index++) {
+            _entries[index].Caps = nullptr;
+        }
+    }
+    ~CapsCache() override
+    {
+        for (uint8_t index = 0; index < Entries; index++) {
+            if (_entries[index].Caps != nullptr) {
+                gst_caps_unref(_entries[index].Caps);
+            }
+        }
+    }
+
+    static CapsCache& Instance(OpenCDMSession& session)
+    {
+        OpenCDMSession::AdapterState* state = session.Adapter();
+
+        if (state == nullptr) {
+            state = session.Adapter(new CapsCache());
+        }
+
+        return (*static_cast<CapsCache*>(state));
+    }
+
+public:
+    MediaProperties Properties(GstCaps* caps)
+    {
+        MediaProperties result;
+
+        _lock.Lock();
+
+        uint8_t index = 0;
+
+        while ((index < Entries) && (_entries[index].Caps != caps)) {
+            index++;
+        }
+
+        if (index == Entries) {
+            index = _next;
+            _next = (_next + 1) % Entries;
+
+            if (_entries[index].Caps != nullptr) {
+                gst_caps_unref(_entries[index].Caps);
+            }
+
+            _entries[index].Caps = gst_caps_ref(caps);
+
+            Parse(caps, _entries[index].Properties);
+        }
+
+        result = _entries[index].Properties;
+
+        _lock.Unlock();
+
+        return (result);
+    }
+
+private:
+    static void Parse(GstCaps* caps, MediaProperties& properties)
+    {
+        properties.height = 0;
+        properties.width = 0;
+        properties.media_type = MediaType_Unknown;
+
+        if (gst_caps_get_size(caps) > 0) {
+            const GstStructure* structure = gst_caps_get_structure(caps, 0);
+
+            // Encrypted caps carry the type of the clear stream separately.
+            const gchar* type = gst_structure_get_string(structure, "original-media-type");
+            if (type == nullptr) {
+                type = gst_structure_get_name(structure);
+            }
+
+            if (g_str_has_prefix(type, "video") == TRUE) {
+                gint width = 0;
+                gint height = 0;
+
+                gst_structure_get_int(structure, "width", &width);
+                gst_structure_get_int(structure, "height", &height);
+
+                properties.width = static_cast<uint16_t>(width);
+                properties.height = static_cast<uint16_t>(height);
+                properties.media_type = MediaType_Video;
+            } else if (g_str_has_prefix(type, "audio") == TRUE) {
+                properties.media_type = MediaType_Audio;
+            } else if ((g_str_has_prefix(type, "text") == TRUE) || (g_str_has_prefix(type, "subpicture") == TRUE) || (g_str_has_prefix(type, "application") == TRUE)) {
+                // Subtitles, captions and other timed metadata.
+                properties.media_type = MediaType_Data;
+            } else {
+                TRACE_L1("Found an unknown media type %s", type);
+            }
+        }
+    }
+
+private:
+    Core::CriticalSection _lock;
+    uint8_t _next;
+    Entry _entries[Entries];
+};
@@ -0,0 +1,186 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 Metrological
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+#include "open_cdm.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace Thunder {
+
+// Decrypt counters and per phase latency histograms of a session. Recording
+// is a handful of relaxed atomic additions, cheap enough to always be on.
+class DecryptStatistics {
+private:
+    static constexpr uint64_t MicroSecondsPerSecond = 1000000;
+
+public:
+    enum phase : uint8_t {
+        LOCK_WAIT,
+        PRODUCE_WAIT,
+        DECRYPT,
+        COPY,
+        PHASES
+    };
+
+private:
+    class Latency {
+    public:
+        Latency(const Latency&) = delete;
+        Latency& operator=(const Latency&) = delete;
+
+        Latency()
+            : _count(0)
+            , _total(0)
+            , _maximum(0)
+        {
+            for (std::atomic<uint32_t>& bucket : _histogram) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+        ~Latency() = default;
+
+    public:
+        void Record(const uint64_t duration)
+        {
+            uint8_t bucket = 0;
+
+            // Bucket n holds durations below 2^n microseconds, the last one the rest.
+            while ((bucket < (OPENCDM_STATISTICS_BUCKETS - 1)) && ((duration >> bucket) != 0)) {
+                bucket++;
+            }
+
+            _histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+            _count.fetch_add(1, std::memory_order_relaxed);
+            _total.fetch_add(duration, std::memory_order_relaxed);
+
+            uint64_t maximum = _maximum.load(std::memory_order_relaxed);
+            while ((duration > maximum) && (_maximum.compare_exchange_weak(maximum, duration, std::memory_order_relaxed) == false)) {
+            }
+        }
+        void Snapshot(OpenCDMLatency& latency) const
+        {
+            latency.count = _count.load(std::memory_order_relaxed);
+            latency.total = _total.load(std::memory_order_relaxed);
+            latency.maximum = _maximum.load(std::memory_order_relaxed);
+
+            for (uint8_t bucket = 0; bucket < OPENCDM_STATISTICS_BUCKETS; bucket++) {
+                latency.histogram[bucket] = _histogram[bucket].load(std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        std::atomic<uint64_t> _count;
+        std::atomic<uint64_t> _total;
+        std::atomic<uint64_t> _maximum;
+        std::atomic<uint32_t> _histogram[OPENCDM_STATISTICS_BUCKETS];
+    };
+
+public:
+    DecryptStatistics(const DecryptStatistics&) = delete;
+    DecryptStatistics& operator=(const DecryptStatistics&) = delete;
+
+    DecryptStatistics()
+        : _samples(0)
+        , _bytes(0)
+        , _failures(0)
+        , _clearSamples(0)
+        , _clearBytes(0)
+        , _first(0)
+        , _last(0)
+    {
+    }
+    ~DecryptStatistics() = default;
+
+public:
+    // Microseconds on a monotonic clock, so wall clock steps (NTP, a user
+    // setting the time) never show up as negative or huge latencies.
+    static uint64_t Now()
+    {
+        return (static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count()));
+    }
+    void Record(const phase which, const uint64_t start, const uint64_t end)
+    {
+        ASSERT(which < PHASES);
+
+        _phases[which].Record(end >= start ? end - start : 0);
+    }
+    void Sample(const uint32_t length, const bool succeeded, const uint64_t start, const uint64_t end)
+    {
+        uint64_t first = 0;
+
+        _first.compare_exchange_strong(first, start, std::memory_order_relaxed);
+        _last.store(end, std::memory_order_relaxed);
+
+        _samples.fetch_add(1, std::memory_order_relaxed);
+        _bytes.fetch_add(length, std::memory_order_relaxed);
+
+        if (succeeded == false) {
+            _failures.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    // Samples found to be clear before they were handed over for decryption.
+    void Clear(const uint32_t length)
+    {
+        _clearSamples.fetch_add(1, std::memory_order_relaxed);
+        _clearBytes.fetch_add(length, std::memory_order_relaxed);
+    }
+    void Snapshot(OpenCDMSessionStatistics& statistics) const
+    {
+        statistics.samples = _samples.load(std::memory_order_relaxed);
+        statistics.bytes = _bytes.load(std::memory_order_relaxed);
+        statistics.failures = _failures.load(std::memory_order_relaxed);
+        statistics.clearSamples = _clearSamples.load(std::memory_order_relaxed);
+        statistics.clearBytes = _clearBytes.load(std::memory_order_relaxed);
+
+        uint64_t first = _first.load(std::memory_order_relaxed);
+        uint64_t last = _last.load(std::memory_order_relaxed);
+
+        statistics.elapsed = (last > first ? last - first : 0);
+
+        if (statistics.elapsed != 0) {
+            statistics.samplesPerSecond = (statistics.samples * MicroSecondsPerSecond) / statistics.elapsed;
+            statistics.bytesPerSecond = (statistics.bytes * MicroSecondsPerSecond) / statistics.elapsed;
+        } else {
+            statistics.samplesPerSecond = 0;
+            statistics.bytesPerSecond = 0;
+        }
+
+        _phases[LOCK_WAIT].Snapshot(statistics.lockWait);
+        _phases[PRODUCE_WAIT].Snapshot(statistics.produceWait);
+        _phases[DECRYPT].Snapshot(statistics.decrypt);
+        _phases[COPY].Snapshot(statistics.copy);
+    }
+
+private:
+    std::atomic<uint64_t> _samples;
+    std::atomic<uint64_t> _bytes;
+    std::atomic<uint64_t> _failures;
+    std::atomic<uint64_t> _clearSamples;
+    std::atomic<uint64_t> _clearBytes;
+    std::atomic<uint64_t> _first;
+    std::atomic<uint64_t> _last;
+    Latency _phases[PHASES];
+};
+
+}
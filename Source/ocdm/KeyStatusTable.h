@@ -0,0 +1,183 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 Metrological
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <interfaces/IOCDM.h>
+
+namespace Thunder {
+
+// Exchange::KeyId treats a 16 byte key ID and its PlayReady byte-swapped
+// counterpart as equal. To be able to index keys, both forms are reduced to
+// the same canonical (lowest) representation.
+class CanonicalKeyId {
+public:
+    CanonicalKeyId()
+    {
+        ::memset(_id, 0, sizeof(_id));
+    }
+    CanonicalKeyId(const CanonicalKeyId&) = default;
+    CanonicalKeyId& operator=(const CanonicalKeyId&) = default;
+
+    CanonicalKeyId(const uint8_t keyId[], const uint8_t length)
+    {
+        uint8_t id[sizeof(_id)];
+        const uint8_t copy = (length > sizeof(id) ? sizeof(id) : length);
+
+        ::memcpy(id, keyId, copy);
+        ::memset(&(id[copy]), 0, sizeof(id) - copy);
+
+        const uint8_t swapped[8] = { id[3], id[2], id[1], id[0], id[5], id[4], id[7], id[6] };
+
+        ::memcpy(_id, (::memcmp(swapped, id, sizeof(swapped)) < 0 ? swapped : id), sizeof(swapped));
+        ::memcpy(&(_id[8]), &(id[8]), sizeof(_id) - 8);
+    }
+    ~CanonicalKeyId() = default;
+
+public:
+    bool operator==(const CanonicalKeyId& rhs) const
+    {
+        return (::memcmp(_id, rhs._id, sizeof(_id)) == 0);
+    }
+    bool operator!=(const CanonicalKeyId& rhs) const
+    {
+        return (!operator==(rhs));
+    }
+    bool operator<(const CanonicalKeyId& rhs) const
+    {
+        return (::memcmp(_id, rhs._id, sizeof(_id)) < 0);
+    }
+    uint32_t Hash() const
+    {
+        // FNV-1a, key IDs are random enough by themselves, this just folds them.
+        uint32_t hash = 2166136261u;
+
+        for (uint8_t index = 0; index < sizeof(_id); index++) {
+            hash = (hash ^ _id[index]) * 16777619u;
+        }
+
+        return (hash);
+    }
+
+private:
+    uint8_t _id[16];
+};
+
+// Flat open-addressing (linear probing) table holding the status per key ID of
+// a session. Key IDs are never removed from a session, so no tombstones are
+// needed. Lookups are a hash and, typically, a single compare on a contiguous
+// slot array, regardless of the number of keys in the session.
+// Not thread safe, the owner is responsible for locking.
+class KeyStatusTable {
+private:
+    static constexpr uint16_t InitialCapacity = 8;
+
+    struct Slot {
+        Slot()
+            : Key()
+            , Status(Exchange::ISession::StatusPending)
+            , Used(false)
+        {
+        }
+
+        CanonicalKeyId Key;
+        Exchange::ISession::KeyStatus Status;
+        bool Used;
+    };
+
+public:
+    KeyStatusTable(const KeyStatusTable&) = delete;
+    KeyStatusTable& operator=(const KeyStatusTable&) = delete;
+
+    KeyStatusTable()
+        : _slots(InitialCapacity)
+        , _count(0)
+    {
+    }
+    ~KeyStatusTable() = default;
+
+public:
+    uint16_t Count() const
+    {
+        return (_count);
+    }
+    bool Contains(const uint8_t keyId[], const uint8_t length) const
+    {
+        return (_slots[Find(CanonicalKeyId(keyId, length))].Used == true);
+    }
+    // Returns StatusPending for keys that were never reported.
+    Exchange::ISession::KeyStatus Status(const uint8_t keyId[], const uint8_t length) const
+    {
+        const Slot& slot(_slots[Find(CanonicalKeyId(keyId, length))]);
+
+        return (slot.Used == true ? slot.Status : Exchange::ISession::StatusPending);
+    }
+    void Status(const uint8_t keyId[], const uint8_t length, const Exchange::ISession::KeyStatus status)
+    {
+        CanonicalKeyId key(keyId, length);
+        uint16_t index = Find(key);
+
+        if (_slots[index].Used == false) {
+            // Keep the load factor below 1/2 so probe sequences stay short.
+            if ((static_cast<size_t>(_count + 1) * 2) > _slots.size()) {
+                Grow();
+                index = Find(key);
+            }
+
+            _slots[index].Key = key;
+            _slots[index].Used = true;
+            _count++;
+        }
+
+        _slots[index].Status = status;
+    }
+
+private:
+    uint16_t Find(const CanonicalKeyId& key) const
+    {
+        const uint16_t mask = static_cast<uint16_t>(_slots.size() - 1);
+        uint16_t index = static_cast<uint16_t>(key.Hash() & mask);
+
+        while ((_slots[index].Used == true) && (_slots[index].Key != key)) {
+            index = (index + 1) & mask;
+        }
+
+        return (index);
+    }
+    void Grow()
+    {
+        std::vector<Slot> old(_slots.size() * 2);
+
+        old.swap(_slots);
+
+        for (const Slot& slot : old) {
+            if (slot.Used == true) {
+                _slots[Find(slot.Key)] = slot;
+            }
+        }
+    }
+
+private:
+    std::vector<Slot> _slots;
+    uint16_t _count;
+};
+
+}
@@ -0,0 +1,62 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 Metrological
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <gst/gst.h>
+#include <gst/base/gstbytereader.h>
+
+// A sample only skips decryption if its protection info explicitly says it is
+// clear: an "encrypted" field set to false, or a subsample map that does not
+// protect a single byte. Missing IV or key ID fields are no such signal, those
+// samples take the regular decrypt path and are rejected there. Telling so
+// only needs the (small) subsample map, not the sample itself.
+inline bool isClearSample(const GstStructure* info)
+{
+    gboolean encrypted = TRUE;
+    bool result = ((gst_structure_get_boolean(info, "encrypted", &encrypted) == TRUE) && (encrypted == FALSE));
+
+    unsigned subSampleCount = 0;
+    const GValue* value = gst_structure_get_value(info, "subsamples");
+
+    if ((result == false) && (value != nullptr) && (gst_structure_get_uint(info, "subsample_count", &subSampleCount) == TRUE) && (subSampleCount > 0)) {
+        GstBuffer* subSamples = gst_value_get_buffer(value);
+        GstMapInfo map;
+
+        if ((subSamples != nullptr) && (gst_buffer_map(subSamples, &map, GST_MAP_READ) == TRUE)) {
+            GstByteReader reader;
+            uint16_t clear = 0;
+            uint32_t encryptedBytes = 0;
+
+            gst_byte_reader_init(&reader, map.data, map.size);
+
+            result = true;
+
+            for (unsigned position = 0; (result == true) && (position < subSampleCount); position++) {
+                result = (gst_byte_reader_get_uint16_be(&reader, &clear) == TRUE) &&
+                         (gst_byte_reader_get_uint32_be(&reader, &encryptedBytes) == TRUE) &&
+                         (encryptedBytes == 0);
+            }
+
+            gst_buffer_unmap(subSamples, &map);
+        }
+    }
+
+    return (result);
+}
@@ -21,8 +21,10 @@
 #include <gst/base/gstbytereader.h>
 
 #include "Module.h"
-#include "CapsParser.h"
 #include "open_cdm_adapter.h"
+#include "open_cdm_impl.h"
+#include "CapsCache.h"
+#include "ProtectionMeta.h"
 
 inline bool mappedBuffer(GstBuffer *buffer, bool writable, uint8_t **data, uint32_t *size)
 {
@@ -39,6 +41,107 @@ inline bool mappedBuffer(GstBuffer *buffer, bool writable, uint8_t **data, uint3
     return true;
 }
 
+// SampleInfo can describe at most this many subsamples, larger maps take the
+// gather/scatter path below.
+static constexpr uint32_t MaxSubSamples = 255;
+
+// Reads the subsample table (pairs of big endian 16 bit clear and 32 bit
+// encrypted byte counts) in a single pass, without any heap allocation. The
+// subsamples together must fit in the sample of dataSize bytes.
+inline bool parseSubSamples(const uint8_t* table, const uint32_t tableSize, const uint32_t count, const uint32_t dataSize, SubSampleInfo subSamples[])
+{
+    GstByteReader reader;
+    bool result = true;
+    uint64_t total = 0;
+
+    ASSERT(count <= MaxSubSamples);
+
+    gst_byte_reader_init(&reader, table, tableSize);
+
+    for (uint32_t position = 0; (result == true) && (position < count); position++) {
+        result = (gst_byte_reader_get_uint16_be(&reader, &subSamples[position].clear_bytes) == TRUE) &&
+                 (gst_byte_reader_get_uint32_be(&reader, &subSamples[position].encrypted_bytes) == TRUE);
+
+        if (result == true) {
+            total += subSamples[position].clear_bytes + static_cast<uint64_t>(subSamples[position].encrypted_bytes);
+            result = (total <= dataSize);
+        }
+    }
+
+    return (result);
+}
+
+// Decrypts a sample with more subsamples than SampleInfo can describe. The
+// protected ranges are gathered into one temporary buffer, decrypted as a
+// whole and scattered back into the sample afterwards.
+static OpenCDMError decryptGathered(struct OpenCDMSession* session, uint8_t data[], const uint32_t size,
+                                    const uint8_t* table, const uint32_t tableSize, const uint32_t count,
+                                    SampleInfo& sampleInfo, uint32_t initWithLast15, const MediaProperties* properties)
+{
+    OpenCDMError result(ERROR_NONE);
+    GstByteReader reader;
+    uint16_t inClear = 0;
+    uint32_t inEncrypted = 0;
+    uint64_t total = 0;
+    uint64_t totalEncrypted = 0;
+
+    gst_byte_reader_init(&reader, table, tableSize);
+
+    for (uint32_t position = 0; (result == ERROR_NONE) && (position < count); position++) {
+        if ((gst_byte_reader_get_uint16_be(&reader, &inClear) == FALSE) || (gst_byte_reader_get_uint32_be(&reader, &inEncrypted) == FALSE)) {
+            result = ERROR_INVALID_DECRYPT_BUFFER;
+        } else {
+            total += inClear + inEncrypted;
+            totalEncrypted += inEncrypted;
+
+            if (total > size) {
+                result = ERROR_INVALID_DECRYPT_BUFFER;
+            }
+        }
+    }
+
+    if (result != ERROR_NONE) {
+        TRACE_L1(_T("Invalid subsample table, %u entries."), count);
+    } else if (totalEncrypted > 0) {
+        std::vector<uint8_t> encryptedData(static_cast<size_t>(totalEncrypted));
+        uint32_t index = 0;
+        uint32_t offset = 0;
+
+        gst_byte_reader_set_pos(&reader, 0);
+
+        for (uint32_t position = 0; position < count; position++) {
+            gst_byte_reader_get_uint16_be(&reader, &inClear);
+            gst_byte_reader_get_uint32_be(&reader, &inEncrypted);
+
+            memcpy(&encryptedData[offset], data + index + inClear, inEncrypted);
+            index += inClear + inEncrypted;
+            offset += inEncrypted;
+        }
+
+        sampleInfo.subSample = nullptr;
+        sampleInfo.subSampleCount = 0;
+
+        result = static_cast<OpenCDMError>(session->Decrypt(encryptedData.data(), static_cast<uint32_t>(totalEncrypted), &sampleInfo, initWithLast15, properties));
+
+        // Re-build sub-sample data.
+        index = 0;
+        offset = 0;
+
+        gst_byte_reader_set_pos(&reader, 0);
+
+        for (uint32_t position = 0; position < count; position++) {
+            gst_byte_reader_get_uint16_be(&reader, &inClear);
+            gst_byte_reader_get_uint32_be(&reader, &inEncrypted);
+
+            memcpy(data + index + inClear, &encryptedData[offset], inEncrypted);
+            index += inClear + inEncrypted;
+            offset += inEncrypted;
+        }
+    }
+
+    return (result);
+}
+
 OpenCDMError opencdm_gstreamer_session_decrypt(struct OpenCDMSession* session, GstBuffer* buffer, GstBuffer* subSampleBuffer, const uint32_t subSampleCount,
                                                GstBuffer* IV, GstBuffer* keyID, uint32_t initWithLast15)
 {
@@ -109,49 +212,41 @@ OpenCDMError opencdm_gstreamer_session_decrypt(struct OpenCDMSession* session, G
             }
             uint8_t *mappedSubSample = reinterpret_cast<uint8_t* >(sampleMap.data);
             uint32_t mappedSubSampleSize = static_cast<uint32_t >(sampleMap.size);
-            GstByteReader* reader = gst_byte_reader_new(mappedSubSample, mappedSubSampleSize);
-            uint16_t inClear = 0;
-            uint32_t inEncrypted = 0;
-            uint32_t totalEncrypted = 0;
-            for (unsigned int position = 0; position < subSampleCount; position++) {
-
-                gst_byte_reader_get_uint16_be(reader, &inClear);
-                gst_byte_reader_get_uint32_be(reader, &inEncrypted);
-                totalEncrypted += inEncrypted;
-            }
-            gst_byte_reader_set_pos(reader, 0);
-
-            uint8_t* encryptedData = reinterpret_cast<uint8_t*>(malloc(totalEncrypted));
-            uint8_t* encryptedDataIter = encryptedData;
-
-            uint32_t index = 0;
-            for (unsigned int position = 0; position < subSampleCount; position++) {
 
-                gst_byte_reader_get_uint16_be(reader, &inClear);
-                gst_byte_reader_get_uint32_be(reader, &inEncrypted);
-
-                memcpy(encryptedDataIter, mappedData + index + inClear, inEncrypted);
-                index += inClear + inEncrypted;
-                encryptedDataIter += inEncrypted;
-            }
-            gst_byte_reader_set_pos(reader, 0);
-
-
-            result = opencdm_session_decrypt(session, encryptedData, totalEncrypted, encScheme, pattern, mappedIV, mappedIVSize, mappedKeyID, mappedKeyIDSize, initWithLast15);
-            // Re-build sub-sample data.
-            index = 0;
-            unsigned total = 0;
-            for (uint32_t position = 0; position < subSampleCount; position++) {
-                gst_byte_reader_get_uint16_be(reader, &inClear);
-                gst_byte_reader_get_uint32_be(reader, &inEncrypted);
+            SampleInfo sampleInfo;
+            sampleInfo.subSample = nullptr;
+            sampleInfo.subSampleCount = 0;
+            sampleInfo.scheme = encScheme;
+            sampleInfo.pattern.clear_blocks = pattern.clear_blocks;
+            sampleInfo.pattern.encrypted_blocks = pattern.encrypted_blocks;
+            sampleInfo.iv = mappedIV;
+            sampleInfo.ivLength = static_cast<uint8_t>(mappedIVSize);
+            sampleInfo.keyId = mappedKeyID;
+            sampleInfo.keyIdLength = static_cast<uint8_t>(mappedKeyIDSize);
+
+            if (subSampleCount == 0) {
+                // An empty subsample map protects no bytes, the sample stays as it is.
+                result = ERROR_NONE;
+            } else if (subSampleCount > MaxSubSamples) {
+                result = decryptGathered(session, mappedData, mappedDataSize, mappedSubSample, mappedSubSampleSize, subSampleCount, sampleInfo, initWithLast15, nullptr);
+            } else {
+                // Hand the subsample map to the DRM implementation, so the protected
+                // ranges are decrypted in place instead of being gathered into a
+                // temporary buffer and scattered back afterwards.
+                SubSampleInfo subSamples[MaxSubSamples];
+
+                if (parseSubSamples(mappedSubSample, mappedSubSampleSize, subSampleCount, mappedDataSize, subSamples) == false) {
+                    TRACE_L1(_T("Invalid subsample table, %u entries."), subSampleCount);
+                    result = ERROR_INVALID_DECRYPT_BUFFER;
+                } else {
+                    sampleInfo.subSample = subSamples;
+                    sampleInfo.subSampleCount = static_cast<uint8_t>(subSampleCount);
 
-                memcpy(mappedData + total + inClear, encryptedData + index, inEncrypted);
-                index += inEncrypted;
-                total += inClear + inEncrypted;
+                    // Same as opencdm_session_decrypt_v2, but honour initWithLast15.
+                    result = static_cast<OpenCDMError>(session->Decrypt(mappedData, mappedDataSize, &sampleInfo, initWithLast15, nullptr));
+                }
             }
 
-            gst_byte_reader_free(reader);
-            free(encryptedData);
             gst_buffer_unmap(subSampleBuffer, &sampleMap);
         } else {
             result = opencdm_session_decrypt(session, mappedData, mappedDataSize, encScheme, pattern, mappedIV, mappedIVSize, mappedKeyID, mappedKeyIDSize, initWithLast15);
@@ -175,6 +270,14 @@ OpenCDMError opencdm_gstreamer_session_decrypt_buffer(struct OpenCDMSession* ses
 
     if (session != nullptr) {
 
+        // Nothing to decrypt (clear leaders, clear audio frames), leave the buffer untouched.
+        GstProtectionMeta* clearMeta = reinterpret_cast<GstProtectionMeta*>(gst_buffer_get_protection_meta(buffer));
+        if ((clearMeta != nullptr) && (isClearSample(clearMeta->info) == true)) {
+            session->ClearSample(static_cast<uint32_t>(gst_buffer_get_size(buffer)));
+            result = ERROR_NONE;
+            goto exit;
+        }
+
         uint8_t *mappedData = nullptr;
         uint32_t mappedDataSize = 0;
         if (mappedBuffer(buffer, true, &mappedData, &mappedDataSize) == false) {
@@ -259,56 +362,28 @@ OpenCDMError opencdm_gstreamer_session_decrypt_buffer(struct OpenCDMSession* ses
             gst_structure_get_uint(protectionMeta->info, "skip_byte_block", &pattern.clear_blocks);
 
             //Create a SubSampleInfo Array with mapping
+            SubSampleInfo subSamples[MaxSubSamples];
             SubSampleInfo * subSampleInfoPtr = nullptr;
-            if (subSample != nullptr) {
-                GstByteReader* reader = gst_byte_reader_new(mappedSubSample, mappedSubSampleSize);
-                subSampleInfoPtr = reinterpret_cast<SubSampleInfo*>(malloc(subSampleCount * sizeof(SubSampleInfo)));
-                for (unsigned int position = 0; position < subSampleCount; position++) {
-
-                    gst_byte_reader_get_uint16_be(reader, &subSampleInfoPtr[position].clear_bytes);
-                    gst_byte_reader_get_uint32_be(reader, &subSampleInfoPtr[position].encrypted_bytes);
+            if ((subSample != nullptr) && (subSampleCount <= MaxSubSamples)) {
+                if (parseSubSamples(mappedSubSample, mappedSubSampleSize, subSampleCount, mappedDataSize, subSamples) == false) {
+                    TRACE_L1("opencdm_gstreamer_session_decrypt_buffer: Invalid subsample table.");
+                    result = ERROR_INVALID_DECRYPT_BUFFER;
+                    goto exit;
                 }
-                gst_byte_reader_set_pos(reader, 0);
-                gst_byte_reader_free(reader);
+                subSampleInfoPtr = subSamples;
             }
 
             //Get Stream Properties from GstCaps
-            MediaProperties *spPtr = nullptr;
             MediaProperties streamProperties;
+            const MediaProperties *spPtr = nullptr;
             if(caps != nullptr){
-                gchar *capsStr = gst_caps_to_string (caps);
-                if (capsStr != nullptr) {
-                    Thunder::Plugin::CapsParser capsParser;
-                    capsParser.Parse(reinterpret_cast<const uint8_t*>(capsStr), strlen(capsStr));
-                    streamProperties.height = capsParser.GetHeight();
-                    streamProperties.width = capsParser.GetWidth();
-                    switch (capsParser.GetMediaType()) {
-                        case CDMi::MediaType::Video:
-                            streamProperties.media_type = MediaType_Video;
-                        break;
-
-                        case CDMi::MediaType::Audio:
-                            streamProperties.media_type = MediaType_Audio;
-                        break;
-
-                        case CDMi::MediaType::Data:
-                            streamProperties.media_type = MediaType_Data;
-                        break;
-
-                        default:
-                            streamProperties.media_type = MediaType_Unknown;
-                        break;
-                    }
-                    spPtr = &streamProperties;
-                    g_free(capsStr);
-                } else {
-                    TRACE_L1("Could not convert caps to string");
-                }
+                streamProperties = CapsCache::Instance(*session).Properties(caps);
+                spPtr = &streamProperties;
             }
 
             SampleInfo sampleInfo;
             sampleInfo.subSample = subSampleInfoPtr;
-            sampleInfo.subSampleCount = subSampleCount;
+            sampleInfo.subSampleCount = (subSampleInfoPtr != nullptr ? subSampleCount : 0);
             sampleInfo.scheme = encScheme;
             sampleInfo.pattern.clear_blocks = pattern.clear_blocks;
             sampleInfo.pattern.encrypted_blocks = pattern.encrypted_blocks;
@@ -317,16 +392,15 @@ OpenCDMError opencdm_gstreamer_session_decrypt_buffer(struct OpenCDMSession* ses
             sampleInfo.keyId = mappedKeyID;
             sampleInfo.keyIdLength = mappedKeyIDSize;
 
-            result = opencdm_session_decrypt_v2(session,
-                                                mappedData,
-                                                mappedDataSize,
-                                                &sampleInfo,
-                                                spPtr);
-
-            //Clean up
-            if(subSampleInfoPtr != nullptr) {
-               free(subSampleInfoPtr);
-           }
+            if ((subSample != nullptr) && (subSampleCount > MaxSubSamples)) {
+                result = decryptGathered(session, mappedData, mappedDataSize, mappedSubSample, mappedSubSampleSize, subSampleCount, sampleInfo, 0, spPtr);
+            } else {
+                result = opencdm_session_decrypt_v2(session,
+                                                    mappedData,
+                                                    mappedDataSize,
+                                                    &sampleInfo,
+                                                    spPtr);
+            }
         } else {
             TRACE_L1("opencdm_gstreamer_session_decrypt_buffer: Missing Protection Metadata.");
             result = ERROR_INVALID_DECRYPT_BUFFER;
@@ -19,13 +19,14 @@
 
 #include "open_cdm_adapter.h"
 #include "open_cdm_impl.h"
+#include "CapsCache.h"
+#include "ProtectionMeta.h"
 
 #include "Module.h"
 #include <gst/gst.h>
 #include <gst/base/gstbytereader.h>
 
 #include <gst_svp_meta.h>
-#include "../CapsParser.h"
 
 
 EXTERNAL OpenCDMError opencdm_gstreamer_transform_caps(GstCaps** caps)
@@ -38,6 +39,33 @@ EXTERNAL OpenCDMError opencdm_gstreamer_transform_caps(GstCaps** caps)
     return (result);
 }
 
+// The SVP media type and the GstPerf suffix for the parsed caps properties.
+static media_type svpMediaType(const MediaProperties& properties)
+{
+    return (properties.media_type == MediaType_Video ? Video : (properties.media_type == MediaType_Audio ? Audio : Data));
+}
+
+static const char* perfSuffix(const MediaProperties& properties)
+{
+    const char* result = "_Unknown";
+
+    switch (properties.media_type) {
+    case MediaType_Video:
+        result = "_Video";
+        break;
+    case MediaType_Audio:
+        result = "_Audio";
+        break;
+    case MediaType_Data:
+        result = "_Data";
+        break;
+    default:
+        break;
+    }
+
+    return (result);
+}
+
 bool swapIVBytes(uint8_t *mappedIV,uint32_t mappedIVSize)
 {
     uint8_t buf;
@@ -233,6 +261,20 @@ OpenCDMError opencdm_gstreamer_session_decrypt_buffer(struct OpenCDMSession* ses
     
     if (session != nullptr) {
 
+        // Nothing to decrypt (clear leaders, clear audio frames), only the SVP
+        // transform is needed, which does not need the buffer mapped.
+        GstProtectionMeta* clearMeta = reinterpret_cast<GstProtectionMeta*>(gst_buffer_get_protection_meta(buffer));
+        if ((clearMeta != nullptr) && (isClearSample(clearMeta->info) == true)) {
+            media_type clearType = Data;
+            if (caps != nullptr) {
+                clearType = svpMediaType(CapsCache::Instance(*session).Properties(caps));
+            }
+            gst_buffer_svp_transform_from_cleardata(session->SessionPrivateData(), buffer, clearType);
+            session->ClearSample(static_cast<uint32_t>(gst_buffer_get_size(buffer)));
+            result = ERROR_NONE;
+            goto exit;
+        }
+
         GstMapInfo dataMap;
         if (gst_buffer_map(buffer, &dataMap, (GstMapFlags) GST_MAP_READWRITE) == false) {
 
@@ -339,45 +381,12 @@ OpenCDMError opencdm_gstreamer_session_decrypt_buffer(struct OpenCDMSession* ses
             //Get Stream Properties from GstCaps
             MediaProperties streamProperties = { 0 };
             if(caps != nullptr){
-                gchar *capsStr = gst_caps_to_string (caps);
-                if (capsStr != nullptr) {
-                    WPEFramework::Plugin::CapsParser capsParser;
-                    capsParser.Parse(reinterpret_cast<const uint8_t*>(capsStr), strlen(capsStr));
-                    streamProperties.height = capsParser.GetHeight();
-                    streamProperties.width = capsParser.GetWidth();
-                    switch (capsParser.GetMediaType()) {
-                        case CDMi::MediaType::Video:
-                            streamProperties.media_type = MediaType_Video;
-                            mediaType = Video;
-                            perfString += "_Video";
-                        break;
-
-                        case CDMi::MediaType::Audio:
-                            streamProperties.media_type = MediaType_Audio;
-                            mediaType = Audio;
-                            perfString += "_Audio";
-                        break;
-
-                        case CDMi::MediaType::Data:
-                            streamProperties.media_type = MediaType_Data;
-                            mediaType = Data;
-                            perfString += "_Data";
-                        break;
-
-                        default:
-                            streamProperties.media_type = MediaType_Unknown;
-                            perfString += "_Unknown";
-                        break;
-                    }
-
-                    if (subSample == nullptr && IV == nullptr && keyID == nullptr) {
-                       perfString += "_clearData";
-                    }
-
-                    g_free(capsStr);
-                } else {
-                    perfString += "_NoGstCaps";
-                    TRACE_L1("Could not convert caps to string\n");
+                streamProperties = CapsCache::Instance(*session).Properties(caps);
+                mediaType = svpMediaType(streamProperties);
+                perfString += perfSuffix(streamProperties);
+
+                if (subSample == nullptr && IV == nullptr && keyID == nullptr) {
+                   perfString += "_clearData";
                 }
             }
             GstPerf perf(perfString.c_str());
@@ -24,7 +24,6 @@ MODULE_NAME_DECLARATION(BUILD_REFERENCE)
 
 using namespace Thunder;
 
-Core::CriticalSection _systemLock;
 const char EmptyString[] = { '\0' };
 
 namespace 
@@ -55,6 +54,21 @@ OpenCDMError StringToAllocatedBuffer(const std::string& source, char* destinatio
     return result;
 }
 
+// The accessor singleton, once it exists. Disposing has to reach it without
+// creating it.
+std::atomic<OpenCDMAccessor*> CreatedAccessor(nullptr);
+
+// Session constructions in progress use the accessor and report to the user,
+// both have to happen before the accessor starts to go away.
+void DisposeConstructions()
+{
+    OpenCDMAccessor* accessor = CreatedAccessor.load();
+
+    if (accessor != nullptr) {
+        accessor->DisposeConstructions();
+    }
+}
+
 } // namespace
 
 /* static */ OpenCDMAccessor* OpenCDMAccessor::Instance()
@@ -73,12 +87,16 @@ OpenCDMError StringToAllocatedBuffer(const std::string& source, char* destinatio
         }
         ~TheOne() {
 
+            DisposeConstructions();
+
             if( Core::SingletonType<OpenCDMAccessor>::Dispose() == true ) {
                 // if the accessor was disposed here because the destructor of the static instance was called there
                 // was no proper dispose before (opencdm_dispose and/or Singleton::Dispose). 
                 // The static dispose might be incomplete or have side effects (e.g. Threads could already be killed)
                 TRACE_L1(_T("OpenCDM Accessor was not disposed properly"));
             }
+
+            CreatedAccessor = nullptr;
         }
 
     public:
@@ -89,6 +107,7 @@ OpenCDMError StringToAllocatedBuffer(const std::string& source, char* destinatio
     } singleton;
 
     OpenCDMAccessor& result = singleton.Instance();
+    CreatedAccessor = &result;
     return &result;
 }
 
@@ -348,6 +367,40 @@ opencdm_construct_session(struct OpenCDMSystem* system,
     return result;
 }
 
+/**
+ * \brief Creates several DRM sessions at the same time.
+ *
+ * The sessions are constructed on the threads of the accessor, the last one
+ * to finish reports the outcome of all of them.
+ * \param system Instance of \ref OpenCDMAccessor.
+ * \param requests The sessions to construct.
+ * \param count Number of requests.
+ * \param callback Called once all are done.
+ * \param userData Passed along to the callback.
+ * \return Zero if the constructions were started, non-zero on error.
+ */
+OpenCDMError opencdm_construct_sessions(struct OpenCDMSystem* system,
+    OpenCDMSessionRequest requests[], const uint32_t count,
+    opencdm_sessions_constructed_callback callback, void* userData)
+{
+    OpenCDMError result(OpenCDMError::ERROR_INVALID_ARG);
+
+    ASSERT(system != nullptr);
+    ASSERT(callback != nullptr);
+    ASSERT((requests != nullptr) || (count == 0));
+
+    if ((system != nullptr) && (callback != nullptr) && ((requests != nullptr) || (count == 0))) {
+        if (count == 0) {
+            callback(system, userData, requests, count);
+            result = OpenCDMError::ERROR_NONE;
+        } else {
+            result = static_cast<OpenCDMError>(OpenCDMAccessor::Instance()->ConstructSessions(system, requests, count, callback, userData));
+        }
+    }
+
+    return (result);
+}
+
 /**
  * Destructs an \ref OpenCDMSession instance.
  * \param system \ref OpenCDMSession instance to desctruct.
@@ -706,6 +759,187 @@ OpenCDMError opencdm_session_decrypt_v2(struct OpenCDMSession* session,
     return (result);
 }
 
+OpenCDMError opencdm_session_prepare(struct OpenCDMSession* session)
+{
+    OpenCDMError result(OpenCDMError::ERROR_INVALID_SESSION);
+
+    ASSERT(session != nullptr);
+
+    if (session != nullptr) {
+        result = static_cast<OpenCDMError>(session->Prepare());
+    }
+
+    return (result);
+}
+
+OpenCDMError opencdm_session_decrypt_async(struct OpenCDMSession* session,
+    uint8_t encrypted[],
+    const uint32_t encryptedLength,
+    const SampleInfo* sampleInfo,
+    const MediaProperties* properties,
+    opencdm_decrypt_complete_callback callback,
+    void* userData)
+{
+    OpenCDMError result(OpenCDMError::ERROR_INVALID_SESSION);
+
+    ASSERT(session != nullptr);
+    ASSERT(callback != nullptr);
+
+    if (session != nullptr) {
+        if ((callback == nullptr) || ((encrypted == nullptr) && (encryptedLength > 0))) {
+            result = OpenCDMError::ERROR_INVALID_ARG;
+        } else {
+            result = static_cast<OpenCDMError>(session->DecryptAsync(encrypted, encryptedLength, sampleInfo, properties, callback, userData));
+        }
+    }
+
+    return (result);
+}
+
+OpenCDMError opencdm_session_decrypt_batch(struct OpenCDMSession* session,
+    SampleBuffer samples[],
+    const uint32_t count,
+    const MediaProperties* properties)
+{
+    OpenCDMError result(OpenCDMError::ERROR_INVALID_SESSION);
+
+    ASSERT(session != nullptr);
+    ASSERT((samples != nullptr) || (count == 0));
+
+    if (session != nullptr) {
+        if ((samples == nullptr) && (count > 0)) {
+            result = OpenCDMError::ERROR_INVALID_ARG;
+        } else {
+            result = count > 0 ? static_cast<OpenCDMError>(session->DecryptBatch(
+                samples, count, properties)) : OpenCDMError::ERROR_NONE;
+        }
+    }
+
+    return (result);
+}
+
+OpenCDMError opencdm_session_decrypt_submit(struct OpenCDMSession* session,
+    uint8_t encrypted[],
+    const uint32_t encryptedLength,
+    const SampleInfo* sampleInfo,
+    const MediaProperties* properties)
+{
+    OpenCDMError result(OpenCDMError::ERROR_INVALID_SESSION);
+
+    ASSERT(session != nullptr);
+
+    if (session != nullptr) {
+        if ((encrypted == nullptr) && (encryptedLength > 0)) {
+            result = OpenCDMError::ERROR_INVALID_ARG;
+        } else {
+            result = static_cast<OpenCDMError>(session->DecryptSubmit(encrypted, encryptedLength, sampleInfo, properties));
+        }
+    }
+
+    return (result);
+}
+
+OpenCDMError opencdm_session_decrypt_complete(struct OpenCDMSession* session,
+    uint8_t** encrypted,
+    uint32_t* encryptedLength)
+{
+    OpenCDMError result(OpenCDMError::ERROR_INVALID_SESSION);
+
+    ASSERT(session != nullptr);
+    ASSERT(encrypted != nullptr);
+    ASSERT(encryptedLength != nullptr);
+
+    if (session != nullptr) {
+        if ((encrypted == nullptr) || (encryptedLength == nullptr)) {
+            result = OpenCDMError::ERROR_INVALID_ARG;
+        } else {
+            result = static_cast<OpenCDMError>(session->DecryptComplete(*encrypted, *encryptedLength));
+        }
+    }
+
+    return (result);
+}
+
+/**
+ * \brief Claims a region of the shared decrypt buffer of a session.
+ * \param session \ref OpenCDMSession instance.
+ * \param length Length of the region to claim (in bytes).
+ * \param buffer Output parameter that will contain the writable region.
+ * \return Zero on success, non-zero on error.
+ */
+OpenCDMError opencdm_session_acquire_buffer(struct OpenCDMSession* session,
+    const uint32_t length,
+    uint8_t** buffer)
+{
+    OpenCDMError result(OpenCDMError::ERROR_INVALID_SESSION);
+
+    ASSERT(session != nullptr);
+    ASSERT(buffer != nullptr);
+
+    if (session != nullptr) {
+        if ((buffer == nullptr) || (length == 0)) {
+            result = OpenCDMError::ERROR_INVALID_ARG;
+        } else {
+            result = static_cast<OpenCDMError>(session->AcquireBuffer(length, *buffer));
+        }
+    }
+
+    return (result);
+}
+
+OpenCDMError opencdm_session_decrypt_in_place(struct OpenCDMSession* session,
+    const SampleInfo* sampleInfo,
+    const MediaProperties* properties)
+{
+    OpenCDMError result(OpenCDMError::ERROR_INVALID_SESSION);
+
+    ASSERT(session != nullptr);
+
+    if (session != nullptr) {
+        result = static_cast<OpenCDMError>(session->DecryptInPlace(sampleInfo, properties));
+    }
+
+    return (result);
+}
+
+OpenCDMError opencdm_session_release_buffer(struct OpenCDMSession* session)
+{
+    OpenCDMError result(OpenCDMError::ERROR_INVALID_SESSION);
+
+    ASSERT(session != nullptr);
+
+    if (session != nullptr) {
+        result = static_cast<OpenCDMError>(session->ReleaseBuffer());
+    }
+
+    return (result);
+}
+
+/**
+ * \brief Retrieves the decrypt statistics of a session.
+ *
+ * \param session \ref OpenCDMSession instance.
+ * \param statistics Filled with the statistics on return.
+ * \return Zero on success, non-zero on error.
+ */
+OpenCDMError opencdm_session_get_statistics(const struct OpenCDMSession* session,
+    OpenCDMSessionStatistics* statistics)
+{
+    OpenCDMError result(OpenCDMError::ERROR_INVALID_SESSION);
+
+    ASSERT(session != nullptr);
+    ASSERT(statistics != nullptr);
+
+    if (statistics == nullptr) {
+        result = OpenCDMError::ERROR_INVALID_ARG;
+    } else if (session != nullptr) {
+        session->Statistics(*statistics);
+        result = OpenCDMError::ERROR_NONE;
+    }
+
+    return (result);
+}
+
 /**
  * \brief Get metrics associated with a DRM session.
  *
@@ -736,7 +970,11 @@ OpenCDMError opencdm_get_metric_session_data(struct OpenCDMSession* session,
 }
 
 void opencdm_dispose() {
+    DisposeConstructions();
+
     Core::SingletonType<OpenCDMAccessor>::Dispose();
+
+    CreatedAccessor = nullptr;
 }
 
 bool OpenCDMAccessor::WaitForKey(const uint8_t keyLength, const uint8_t keyId[],
@@ -746,57 +984,85 @@ bool OpenCDMAccessor::WaitForKey(const uint8_t keyLength, const uint8_t keyId[],
     {
         bool result = false;
         uint64_t timeOut(Core::Time::Now().Add(waitTime).Ticks());
+        CanonicalKeyId key(keyId, keyLength);
+        KeyWaiter waiter;
+        bool registered = false;
 
-        do {
-            _adminLock.Lock();
-
-            KeyMap::const_iterator session(_sessionKeys.begin());
+        _sessionLock.Lock();
 
-            for  (; session != _sessionKeys.end(); ++session) {
-                if (!system || session->second->BelongsTo(system) == true) {
-                    if(session->second->Status(keyLength, keyId) == status) {
-                        result = true;
-                        break;
+        do {
+            KeyIndex::const_iterator entry(_keyIndex.find(key));
+
+            if (entry != _keyIndex.end()) {
+                std::list<OpenCDMSession*>::const_iterator session(entry->second.Sessions.begin());
+
+                for (; session != entry->second.Sessions.end(); ++session) {
+                    if (!system || (*session)->BelongsTo(system) == true) {
+                        if ((*session)->Status(keyLength, keyId) == status) {
+                            sessionId = (*session)->SessionId();
+                            result = true;
+                            break;
+                        }
                     }
                 }
             }
 
             if (result == false) {
-                Exchange::KeyId paramKey(keyId, keyLength);
-                _interested++;
-
-                _adminLock.Unlock();
+                uint64_t now(Core::Time::Now().Ticks());
 
-                TRACE_L1("Waiting for KeyId: %s", paramKey.ToString().c_str());
+                if (now >= timeOut) {
+                    break;
+                }
 
-                uint64_t now(Core::Time::Now().Ticks());
+                if (registered == false) {
+                    // Only updates of this key will wake us up.
+                    _keyIndex[key].Waiters.push_back(&waiter);
+                    registered = true;
 
-                if (now < timeOut) {
-                    _signal.Lock(static_cast<uint32_t>((timeOut - now) / Core::Time::TicksPerMillisecond));
+                    TRACE_L1("Waiting for KeyId: %s", Exchange::KeyId(keyId, keyLength).ToString().c_str());
                 }
 
-                Core::InterlockedDecrement(_interested);
-            } else {
-                sessionId = session->first;
-                _adminLock.Unlock();
+                _sessionLock.Unlock();
+
+                waiter.Wait(static_cast<uint32_t>((timeOut - now) / Core::Time::TicksPerMillisecond));
+
+                _sessionLock.Lock();
+
+                waiter.Reset();
             }
-        } while ((result == false) && (timeOut > Core::Time::Now().Ticks()));
+        } while (result == false);
+
+        if (registered == true) {
+            KeyIndex::iterator entry(_keyIndex.find(key));
+
+            ASSERT(entry != _keyIndex.end());
+
+            entry->second.Waiters.remove(&waiter);
+
+            if ((entry->second.Waiters.empty() == true) && (entry->second.Sessions.empty() == true)) {
+                _keyIndex.erase(entry);
+            }
+        }
+
+        _sessionLock.Unlock();
 
         return (result);
     }
     OpenCDMSession* OpenCDMAccessor::Session(const std::string& sessionId)
     {
         OpenCDMSession* result = nullptr;
-        KeyMap::iterator index = _sessionKeys.find(sessionId);
 
-        _adminLock.Lock();
+        _sessionLock.Lock();
+
+        KeyMap::iterator index = _sessionKeys.find(sessionId);
 
-        if(index != _sessionKeys.end()){
+        // A session that is being destructed is still in the map until its
+        // destructor gets here, it can no longer be handed out though.
+        if ((index != _sessionKeys.end()) && (index->second->TryAddRef() == true)) {
             result = index->second;
-            result->AddRef();
         }
 
-        _adminLock.Unlock();
+        _sessionLock.Unlock();
 
         return (result);
     }
@@ -805,7 +1071,7 @@ bool OpenCDMAccessor::WaitForKey(const uint8_t keyLength, const uint8_t keyId[],
     {
         string sessionId = session->SessionId();
 
-        _adminLock.Lock();
+        _sessionLock.Lock();
 
         KeyMap::iterator index(_sessionKeys.find(sessionId));
 
@@ -816,31 +1082,61 @@ bool OpenCDMAccessor::WaitForKey(const uint8_t keyLength, const uint8_t keyId[],
                 sessionId.c_str());
         }
 
-        _adminLock.Unlock();
+        _sessionLock.Unlock();
     }
-    void OpenCDMAccessor::RemoveSession(const string& sessionId)
+    void OpenCDMAccessor::RemoveSession(const OpenCDMSession* session)
     {
-        _adminLock.Lock();
+        _sessionLock.Lock();
 
-        KeyMap::iterator index(_sessionKeys.find(sessionId));
+        KeyMap::iterator index(_sessionKeys.find(session->SessionId()));
 
-        if (index != _sessionKeys.end()) {
+        if ((index != _sessionKeys.end()) && (index->second == session)) {
             _sessionKeys.erase(index);
         } else {
             TRACE_L1("A session is destroyed of which we were not aware [%s]",
-                sessionId.c_str());
+                session->SessionId().c_str());
+        }
+
+        KeyIndex::iterator entry(_keyIndex.begin());
+
+        while (entry != _keyIndex.end()) {
+            entry->second.Sessions.remove(const_cast<OpenCDMSession*>(session));
+
+            if ((entry->second.Sessions.empty() == true) && (entry->second.Waiters.empty() == true)) {
+                entry = _keyIndex.erase(entry);
+            } else {
+                ++entry;
+            }
+        }
+
+        _sessionLock.Unlock();
+    }
+
+    void OpenCDMAccessor::KeyUpdate(OpenCDMSession* session, const uint8_t keyId[], const uint8_t keyLength)
+    {
+        _sessionLock.Lock();
+
+        KeyEntry& entry(_keyIndex[CanonicalKeyId(keyId, keyLength)]);
+
+        if (std::find(entry.Sessions.begin(), entry.Sessions.end(), session) == entry.Sessions.end()) {
+            entry.Sessions.push_back(session);
+        }
+
+        // Only wake up the ones that are waiting for this specific key.
+        for (KeyWaiter* waiter : entry.Waiters) {
+            waiter->Notify();
         }
 
-        _adminLock.Unlock();
+        _sessionLock.Unlock();
     }
 
     void OpenCDMAccessor::SystemBeingDestructed(OpenCDMSystem* system)
     {
-        _adminLock.Lock();
+        _sessionLock.Lock();
         for (auto& sessionKey : _sessionKeys) {
             if (sessionKey.second->BelongsTo(system) == true) {
                 TRACE_L1("System the session %s belongs to is being destructed. Destruct the session before destructing the system!", sessionKey.second->SessionId().c_str());
             }
         }
-        _adminLock.Unlock();
+        _sessionLock.Unlock();
     }
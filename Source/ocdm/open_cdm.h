@@ -197,6 +197,53 @@ typedef enum {
 
 } OpenCDMError;
 
+// One sample of a batch passed to opencdm_session_decrypt_batch
+typedef struct {
+    uint8_t*           data;            // Encrypted data, replaced by the clear data on return
+    uint32_t           length;          // Length of data (in bytes)
+    const SampleInfo*  info;            // Per Sample information needed to decrypt this sample
+    OpenCDMError       result;          // Outcome of the decryption of this sample, set on return
+} SampleBuffer;
+
+#define OPENCDM_STATISTICS_BUCKETS 16
+
+// Latency distribution of one phase of a decrypt, all durations in microseconds.
+// Histogram bucket n counts the durations below 2^n, the last bucket all longer ones.
+typedef struct {
+    uint64_t           count;
+    uint64_t           total;
+    uint64_t           maximum;
+    uint32_t           histogram[OPENCDM_STATISTICS_BUCKETS];
+} OpenCDMLatency;
+
+// Decrypt statistics of a session, as returned by opencdm_session_get_statistics
+typedef struct {
+    uint64_t           samples;          // Number of samples decrypted
+    uint64_t           bytes;            // Number of bytes decrypted
+    uint64_t           failures;         // Number of samples that failed to decrypt
+    uint64_t           clearSamples;     // Number of clear samples passed without decrypting
+    uint64_t           clearBytes;       // Number of bytes in those clear samples
+    uint64_t           elapsed;          // Microseconds between the start of the first and the end of the last sample
+    uint64_t           samplesPerSecond; // Samples decrypted per second over the elapsed time
+    uint64_t           bytesPerSecond;   // Bytes decrypted per second over the elapsed time
+    OpenCDMLatency     lockWait;         // Waiting for other users of this session to finish
+    OpenCDMLatency     produceWait;      // Waiting for the shared buffer to become available
+    OpenCDMLatency     decrypt;          // Decryption by the OpenCDM server
+    OpenCDMLatency     copy;             // Copying the clear data back to the caller
+} OpenCDMSessionStatistics;
+
+/**
+ * Reports the completion of a decrypt queued with \ref opencdm_session_decrypt_async.
+ *
+ * \param session The session the sample was queued on, or NULL if the session
+ * was destructed before the sample could be decrypted.
+ * \param userData Pointer passed along when the sample was queued.
+ * \param data Buffer of the sample, holding the decrypted data if applicable.
+ * \param length Length of the sample (in bytes).
+ * \param result Zero on success, non-zero on error.
+ */
+typedef void (*opencdm_decrypt_complete_callback)(struct OpenCDMSession* session, void* userData, uint8_t data[], const uint32_t length, const OpenCDMError result);
+
 /**
  * OpenCDM bool type. 0 is false, 1 is true.
  */
@@ -249,6 +296,31 @@ typedef struct {
     void (*keys_updated_callback)(const struct OpenCDMSession* session, void* userData);
 } OpenCDMSessionCallbacks;
 
+// One session to construct with opencdm_construct_sessions, the arguments are
+// those of opencdm_construct_session.
+typedef struct {
+    LicenseType               licenseType;
+    const char*               initDataType;
+    const uint8_t*            initData;
+    uint16_t                  initDataLength;
+    const uint8_t*            CDMData;
+    uint16_t                  CDMDataLength;
+    OpenCDMSessionCallbacks*  callbacks;
+    void*                     userData;
+    struct OpenCDMSession*    session;   // Constructed session, set on completion
+    OpenCDMError              result;    // Outcome of the construction, set on completion
+} OpenCDMSessionRequest;
+
+/**
+ * Reports that all sessions requested with \ref opencdm_construct_sessions are constructed.
+ *
+ * \param system The system the sessions were constructed for.
+ * \param userData Pointer passed along when the sessions were requested.
+ * \param requests The requests, with their session and result fields filled in.
+ * \param count Number of requests.
+ */
+typedef void (*opencdm_sessions_constructed_callback)(struct OpenCDMSystem* system, void* userData, OpenCDMSessionRequest requests[], const uint32_t count);
+
 /**
  * \brief Creates DRM system.
  *
@@ -429,6 +501,29 @@ EXTERNAL OpenCDMError opencdm_construct_session(struct OpenCDMSystem* system, co
     const uint8_t CDMData[], const uint16_t CDMDataLength, OpenCDMSessionCallbacks* callbacks, void* userData,
     struct OpenCDMSession** session);
 
+/**
+ * \brief Creates several DRM sessions at the same time.
+ *
+ * Starts the construction of all requested sessions in parallel and returns
+ * right away. Each session generates and reports its challenge through its own
+ * callbacks as soon as it is constructed, so the license requests of e.g. the
+ * audio, SD and HD keys go out together instead of one after the other. Once
+ * all constructions finished, the outcome is reported with one callback.
+ * \param system Instance of \ref OpenCDMAccessor, must stay alive until the callback.
+ * \param requests The sessions to construct, must stay valid until the callback.
+ * \param count Number of requests.
+ * \param callback Called from a thread of the library once all are done. On
+ *        opencdm_dispose, requests not started yet fail with
+ *        ERROR_INVALID_ACCESSOR and the callback comes from the disposing
+ *        thread. The callback must not call opencdm_dispose itself.
+ * \param userData Passed along to the callback.
+ * \return Zero if the constructions were started, ERROR_UNKNOWN if they could
+ *         not be started, e.g. because the library is being disposed.
+ */
+EXTERNAL OpenCDMError opencdm_construct_sessions(struct OpenCDMSystem* system,
+    OpenCDMSessionRequest requests[], const uint32_t count,
+    opencdm_sessions_constructed_callback callback, void* userData);
+
 /**
  * Destructs an \ref OpenCDMSession instance.
  * \param system \ref OpenCDMSession instance to desctruct.
@@ -615,6 +710,21 @@ EXTERNAL OpenCDMError opencdm_get_metric_session_data(struct OpenCDMSession* ses
     uint32_t* bufferLength,
     uint8_t* buffer);
 
+/**
+ * \brief Sets up the decrypt buffer of a session.
+ *
+ * The buffer shared with the DRM implementation is otherwise set up on the
+ * first decrypt, which then carries the cost of it. Calling this right after
+ * constructing the session, e.g. on a channel change, takes that off the path
+ * to the first decrypted frame. Calling it again is harmless.
+ * \param session \ref OpenCDMSession instance.
+ * \return Zero on success, non-zero on error. ERROR_BUSY_CANNOT_INITIALIZE when
+ *         the DRM implementation already set up a buffer for the session that
+ *         can not be reached from here or is in use by someone else, decrypts
+ *         will fail the same way until it can be attached to.
+ */
+EXTERNAL OpenCDMError opencdm_session_prepare(struct OpenCDMSession* session);
+
 /**
  * \brief Performs decryption.
  *
@@ -638,6 +748,154 @@ EXTERNAL OpenCDMError opencdm_session_decrypt_v2(struct OpenCDMSession* session,
     const SampleInfo* sampleInfo,
     const MediaProperties* streamProperties);
 
+/**
+ * \brief Queues a sample for decryption and returns right away.
+ *
+ * Asynchronous variant of \ref opencdm_session_decrypt_v2. The samples queued
+ * on a session are decrypted in order on a thread owned by the session, and
+ * each one is reported through its callback from that thread. The sample
+ * information and stream properties are copied, the sample buffer must stay
+ * valid until the callback for it was called. Destructing the session fails
+ * all samples still queued with ERROR_INVALID_SESSION and a NULL session
+ * before it returns, so it must not be destructed from within the callback.
+ * \param session \ref OpenCDMSession instance.
+ * \param encrypted Buffer containing encrypted data. If applicable, decrypted
+ * data will be stored here before the callback is called.
+ * \param encryptedLength Length of encrypted data buffer (in bytes).
+ * \param sampleInfo Per Sample information needed to decrypt this sample
+ * \param streamProperties Provides info about current stream
+ * \param callback Called once the sample is decrypted.
+ * \param userData Passed along to the callback.
+ * \return Zero if the sample was queued, non-zero on error.
+ */
+EXTERNAL OpenCDMError opencdm_session_decrypt_async(struct OpenCDMSession* session,
+    uint8_t encrypted[],
+    const uint32_t encryptedLength,
+    const SampleInfo* sampleInfo,
+    const MediaProperties* streamProperties,
+    opencdm_decrypt_complete_callback callback,
+    void* userData);
+
+/**
+ * \brief Performs decryption of a batch of samples.
+ *
+ * Equivalent to calling \ref opencdm_session_decrypt_v2 for every sample in
+ * the batch, but the decrypt buffer of the session is claimed only once for
+ * the whole batch, which saves per call overhead for many small samples (e.g.
+ * audio frames). The samples are decrypted in order, the outcome of each
+ * sample is stored in its result field.
+ * \param session \ref OpenCDMSession instance.
+ * \param samples Array of samples to decrypt.
+ * \param count Number of samples in the array.
+ * \param streamProperties Provides info about current stream
+ * \return Zero if all samples were decrypted, non-zero on error.
+ */
+EXTERNAL OpenCDMError opencdm_session_decrypt_batch(struct OpenCDMSession* session,
+    SampleBuffer samples[],
+    const uint32_t count,
+    const MediaProperties* streamProperties);
+
+/**
+ * \brief Hands a sample to the decrypt ring of a session and returns right away.
+ *
+ * Pipelined variant of \ref opencdm_session_decrypt_v2. The encrypted data is
+ * copied into the next free slot of the ring and the DRM implementation starts
+ * decrypting it, meanwhile the caller can prepare and submit the next sample.
+ * The number of slots is set with the OPEN_CDM_DECRYPT_SLOTS environment
+ * variable; if the DRM implementation does not offer slots, the sample is
+ * decrypted before this call returns. The sample buffer must stay valid until
+ * it is handed back by \ref opencdm_session_decrypt_complete. A ring is meant
+ * to be driven from a single thread.
+ * \param session \ref OpenCDMSession instance.
+ * \param encrypted Buffer containing encrypted data. If applicable, decrypted
+ * data will be stored here on completion.
+ * \param encryptedLength Length of encrypted data buffer (in bytes).
+ * \param sampleInfo Per Sample information needed to decrypt this sample
+ * \param streamProperties Provides info about current stream
+ * \return Zero if the sample was submitted, ERROR_BUFFER_TOO_SMALL if all
+ * slots are in flight, other non-zero values on error.
+ */
+EXTERNAL OpenCDMError opencdm_session_decrypt_submit(struct OpenCDMSession* session,
+    uint8_t encrypted[],
+    const uint32_t encryptedLength,
+    const SampleInfo* sampleInfo,
+    const MediaProperties* streamProperties);
+
+/**
+ * \brief Waits for the oldest sample submitted with \ref opencdm_session_decrypt_submit.
+ *
+ * Samples complete in the order they were submitted.
+ * \param session \ref OpenCDMSession instance.
+ * \param encrypted Output parameter that will contain the buffer of the
+ * completed sample, as passed on submission.
+ * \param encryptedLength Output parameter that will contain its length.
+ * \return Outcome of the decrypt of the sample, ERROR_INVALID_DECRYPT_BUFFER
+ * if no sample is in flight.
+ */
+EXTERNAL OpenCDMError opencdm_session_decrypt_complete(struct OpenCDMSession* session,
+    uint8_t** encrypted,
+    uint32_t* encryptedLength);
+
+/**
+ * \brief Claims a region of the shared decrypt buffer of a session.
+ *
+ * Zero-copy alternative to \ref opencdm_session_decrypt_v2. The returned region
+ * lives in the memory-mapped buffer shared with the DRM implementation, the
+ * caller writes the encrypted sample directly into it and decrypts it with
+ * \ref opencdm_session_decrypt_in_place. The session buffer stays claimed (other
+ * decrypts on this session block) until \ref opencdm_session_release_buffer is
+ * called from the same thread. Meanwhile that thread can not claim another
+ * region nor decrypt otherwise on this session, and the session is kept
+ * alive even if it is destructed.
+ * \param session \ref OpenCDMSession instance.
+ * \param length Length of the region to claim (in bytes).
+ * \param buffer Output parameter that will contain the writable region.
+ * \return Zero on success, non-zero on error.
+ */
+EXTERNAL OpenCDMError opencdm_session_acquire_buffer(struct OpenCDMSession* session,
+    const uint32_t length,
+    uint8_t** buffer);
+
+/**
+ * \brief Performs decryption of the region claimed with \ref opencdm_session_acquire_buffer.
+ *
+ * If the DRM system allows access to decrypted data, the clear data is
+ * available in the claimed region after this call returns. Copying it to a
+ * buffer of the caller is optional. Without a region claimed by the calling
+ * thread, or if the region was decrypted already, this returns
+ * ERROR_INVALID_DECRYPT_BUFFER.
+ * \param session \ref OpenCDMSession instance.
+ * \param sampleInfo Per Sample information needed to decrypt this sample
+ * \param streamProperties Provides info about current stream
+ * \return Zero on success, non-zero on error.
+ */
+EXTERNAL OpenCDMError opencdm_session_decrypt_in_place(struct OpenCDMSession* session,
+    const SampleInfo* sampleInfo,
+    const MediaProperties* streamProperties);
+
+/**
+ * \brief Releases the region claimed with \ref opencdm_session_acquire_buffer.
+ *
+ * The region may no longer be accessed after this call. Releasing from a
+ * thread that did not claim a region fails with ERROR_INVALID_DECRYPT_BUFFER.
+ * \param session \ref OpenCDMSession instance.
+ * \return Zero on success, non-zero on error.
+ */
+EXTERNAL OpenCDMError opencdm_session_release_buffer(struct OpenCDMSession* session);
+
+/**
+ * \brief Retrieves the decrypt statistics of a session.
+ *
+ * Counters and latency histograms are kept for every decrypt done on the
+ * session since it was constructed. Recording them is cheap, so they are always
+ * available.
+ * \param session \ref OpenCDMSession instance.
+ * \param statistics Filled with the statistics on return.
+ * \return Zero on success, non-zero on error.
+ */
+EXTERNAL OpenCDMError opencdm_session_get_statistics(const struct OpenCDMSession* session,
+    OpenCDMSessionStatistics* statistics);
+
 /**
  * @brief Close the cached open connection if it exists.
  *
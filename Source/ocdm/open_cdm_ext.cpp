@@ -196,6 +196,53 @@ OpenCDMError opencdm_system_ext_commit_secure_stop(
     return (result);
 }
 
+OpenCDMError opencdm_system_ext_get_secure_stops(OpenCDMSystem* system,
+    const uint8_t sessionIDs[],
+    uint32_t sessionIDLength,
+    uint32_t* count,
+    uint8_t buffer[],
+    uint32_t* bufferLength)
+{
+    OpenCDMError result(OpenCDMError::ERROR_INVALID_ARG);
+
+    ASSERT(system != nullptr);
+    ASSERT(count != nullptr);
+    ASSERT(bufferLength != nullptr);
+
+    ASSERT((count == nullptr) || (*count == 0) || ((sessionIDs != nullptr) && (buffer != nullptr)));
+
+    if ((system != nullptr) && (count != nullptr) && (bufferLength != nullptr) && (sessionIDLength <= 0xFFFF) &&
+        ((*count == 0) || ((sessionIDs != nullptr) && (buffer != nullptr)))) {
+        result = static_cast<OpenCDMError>(OpenCDMAccessor::Instance()->GetSecureStops(system->keySystem(),
+                    sessionIDs, static_cast<uint16_t>(sessionIDLength), *count, buffer, *bufferLength));
+    }
+
+    return (result);
+}
+
+OpenCDMError opencdm_system_ext_commit_secure_stops(OpenCDMSystem* system,
+    const uint8_t sessionIDs[],
+    uint32_t sessionIDLength,
+    uint32_t* count,
+    const uint8_t serverResponses[],
+    uint32_t serverResponsesLength)
+{
+    OpenCDMError result(OpenCDMError::ERROR_INVALID_ARG);
+
+    ASSERT(system != nullptr);
+    ASSERT(count != nullptr);
+
+    ASSERT((count == nullptr) || (*count == 0) || ((sessionIDs != nullptr) && (serverResponses != nullptr)));
+
+    if ((system != nullptr) && (count != nullptr) && (sessionIDLength <= 0xFFFF) &&
+        ((*count == 0) || ((sessionIDs != nullptr) && (serverResponses != nullptr)))) {
+        result = static_cast<OpenCDMError>(OpenCDMAccessor::Instance()->CommitSecureStops(system->keySystem(),
+                    sessionIDs, static_cast<uint16_t>(sessionIDLength), *count, serverResponses, serverResponsesLength));
+    }
+
+    return (result);
+}
+
 OpenCDMError opencdm_system_get_drm_time(struct OpenCDMSystem* system,
     uint64_t* time)
 {
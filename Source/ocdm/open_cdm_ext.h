@@ -99,6 +99,45 @@ EXTERNAL OpenCDMError opencdm_system_ext_commit_secure_stop(
     uint32_t sessionIDLength, const uint8_t serverResponse[],
     uint32_t serverResponseLength);
 
+/**
+ * Gets the secure stops of several sessions in one go.
+ * \param system Extended OCDM system handle.
+ * \param sessionIDs Session IDs of sessionIDLength bytes each, back to back
+ * (as returned by \ref opencdm_system_ext_get_secure_stop_ids).
+ * \param sessionIDLength Length of a single session ID (in bytes).
+ * \param count In: number of session IDs, out: number of secure stops fetched.
+ * \param buffer Receives a record per secure stop, in the order of the session
+ * IDs: a 2 byte little endian length followed by the secure stop info.
+ * \param bufferLength In: size of buffer, out: number of bytes used (in bytes).
+ * \return Zero if all secure stops were fetched, ERROR_BUFFER_TOO_SMALL if the
+ * next one did not fit in buffer, non-zero otherwise.
+ */
+EXTERNAL OpenCDMError opencdm_system_ext_get_secure_stops(struct OpenCDMSystem* system,
+    const uint8_t sessionIDs[],
+    uint32_t sessionIDLength,
+    uint32_t* count,
+    uint8_t buffer[],
+    uint32_t* bufferLength);
+
+/**
+ * Commits the secure stops of several sessions in one go.
+ * \param system Extended OCDM system handle.
+ * \param sessionIDs Session IDs of sessionIDLength bytes each, back to back.
+ * \param sessionIDLength Length of a single session ID (in bytes).
+ * \param count In: number of session IDs, out: number of secure stops committed.
+ * \param serverResponses A record per session, in the order of the session IDs:
+ * a 2 byte little endian length followed by the server response.
+ * \param serverResponsesLength Length of serverResponses (in bytes).
+ * \return Zero if all secure stops were committed, ERROR_INVALID_ARG if a record
+ * runs past serverResponsesLength, non-zero otherwise.
+ */
+EXTERNAL OpenCDMError opencdm_system_ext_commit_secure_stops(struct OpenCDMSystem* system,
+    const uint8_t sessionIDs[],
+    uint32_t sessionIDLength,
+    uint32_t* count,
+    const uint8_t serverResponses[],
+    uint32_t serverResponsesLength);
+
 /**
  * Gets Secure key hash.
  * \param system Extended OCDM system handle.
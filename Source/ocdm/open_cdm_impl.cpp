@@ -80,6 +80,18 @@ static SessionPrivate SessionPvt;
                             const uint8_t CDMData[], const uint16_t CDMDataLength,
                             OpenCDMSessionCallbacks* callbacks, void* userData,
                             struct OpenCDMSession** session)
+{
+    return (CreateSession(*OpenCDMAccessor::Instance(), system, licenseType, initDataType,
+                initData, initDataLength, CDMData, CDMDataLength, callbacks, userData, session));
+}
+
+/* static */ OpenCDMError OpenCDMSession::CreateSession(OpenCDMAccessor& accessor,
+                            struct OpenCDMSystem* system,
+                            const LicenseType licenseType, const char initDataType[],
+                            const uint8_t initData[], const uint16_t initDataLength,
+                            const uint8_t CDMData[], const uint16_t CDMDataLength,
+                            OpenCDMSessionCallbacks* callbacks, void* userData,
+                            struct OpenCDMSession** session)
 {
     OpenCDMError result(ERROR_INVALID_ARG);
 
@@ -87,7 +99,7 @@ static SessionPrivate SessionPvt;
     ASSERT(session != nullptr);
 
     if ((system != nullptr) && (session != nullptr)) {
-        *session = new OpenCDMSession(system, std::string(initDataType),
+        *session = new OpenCDMSession(accessor, system, std::string(initDataType),
                             initData, initDataLength, CDMData,
                             CDMDataLength, licenseType, callbacks, userData);
 
@@ -109,14 +121,62 @@ static SessionPrivate SessionPvt;
     return result;
 }
 
+bool OpenCDMAccessor::Constructions::Process()
+{
+    bool result = true;
+
+    _adminLock.Lock();
+
+    if (_jobs.empty() == true) {
+        if (_stopping == true) {
+            result = false;
+        } else {
+            _signal.ResetEvent();
+        }
+
+        _adminLock.Unlock();
+
+        if (result == true) {
+            _signal.Lock(Core::infinite);
+        }
+    } else {
+        Job job(_jobs.front());
+        _jobs.pop_front();
+
+        _adminLock.Unlock();
+
+        OpenCDMSessionRequest& request(job.Owner->Requests[job.Index]);
+
+        TRACE_L1("Creating a Session for %s", job.Owner->System->keySystem().c_str());
+
+        request.session = nullptr;
+        request.result = OpenCDMSession::CreateSession(_accessor, job.Owner->System, request.licenseType, request.initDataType,
+            request.initData, request.initDataLength, request.CDMData, request.CDMDataLength,
+            request.callbacks, request.userData, &request.session);
+
+        Done(job.Owner);
+    }
+
+    return (result);
+}
+
 OpenCDMSession::~OpenCDMSession()
 {
+    // Finish the queued asynchronous decrypts while the session is still whole.
+    delete _asyncDecrypt;
+
     SessionPvt.Destruct(this, _pvtData);
 
-    OpenCDMAccessor::Instance()->RemoveSession(_sessionId);
+    delete _adapterState.load();
 
     if (_session != nullptr) {
         _session->Revoke(&_sink);
+    }
+
+    // No more key updates can come in, so it is safe to forget about us.
+    OpenCDMAccessor::Instance()->RemoveSession(this);
+
+    if (_session != nullptr) {
         Session(nullptr);
     }
 
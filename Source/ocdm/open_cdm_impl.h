@@ -24,13 +24,15 @@
 #include <interfaces/IOCDM.h>
 #include "Module.h"
 #include "open_cdm.h"
+#include "KeyStatusTable.h"
+#include "DecryptStatistics.h"
 
 #include <atomic>
+#include <thread>
+#include <unordered_map>
 
 using namespace Thunder;
 
-extern Core::CriticalSection _systemLock;
-
 struct OpenCDMSystem {
     OpenCDMSystem(const char system[], const std::string& metadata) : _keySystem(system), _metadata(metadata) {}
     ~OpenCDMSystem() = default;
@@ -48,9 +50,223 @@ struct OpenCDMSystem {
 
 struct OpenCDMAccessor : public Exchange::IAccessorOCDM {
 private:
-    typedef std::map<string, OpenCDMSession*> KeyMap;
+    typedef std::unordered_map<string, OpenCDMSession*> KeyMap;
+
+    // Someone blocked in WaitForKey, only woken when its own key changes.
+    class KeyWaiter {
+    public:
+        KeyWaiter(const KeyWaiter&) = delete;
+        KeyWaiter& operator=(const KeyWaiter&) = delete;
+
+        KeyWaiter()
+            : _event(false, true)
+        {
+        }
+        ~KeyWaiter() = default;
+
+    public:
+        void Notify()
+        {
+            _event.SetEvent();
+        }
+        void Reset()
+        {
+            _event.ResetEvent();
+        }
+        void Wait(const uint32_t waitTime)
+        {
+            _event.Lock(waitTime);
+        }
+
+    private:
+        Core::Event _event;
+    };
+
+    struct KeyEntry {
+        std::list<OpenCDMSession*> Sessions;
+        std::list<KeyWaiter*> Waiters;
+    };
+
+    typedef std::map<CanonicalKeyId, KeyEntry> KeyIndex;
+
+    // Answers of the OpenCDMImplementation that do not change while connected.
+    typedef std::map<std::pair<string, string>, bool> SupportCache;
+    typedef std::map<string, string> MetadataCache;
+
+    // Runs the session constructions requested with opencdm_construct_sessions
+    // on a few threads owned by the accessor, so none of them can outlive it.
+    // On Dispose the constructions in progress are finished, the ones not
+    // started yet are reported as failed, so every batch gets its callback.
+    // The sessions are constructed on the accessor handed in, the runners
+    // never look it up, it might be on its way out already.
+    class Constructions {
+    private:
+        static constexpr uint8_t MaxRunners = 4;
+
+        struct Batch {
+            OpenCDMSystem* System;
+            OpenCDMSessionRequest* Requests;
+            uint32_t Count;
+            opencdm_sessions_constructed_callback Callback;
+            void* UserData;
+            std::atomic<uint32_t> Pending;
+        };
+
+        struct Job {
+            Batch* Owner;
+            uint32_t Index;
+        };
+
+        class Runner : public Core::Thread {
+        public:
+            Runner() = delete;
+            Runner(const Runner&) = delete;
+            Runner& operator=(const Runner&) = delete;
+
+            Runner(Constructions& parent)
+                : Core::Thread(Core::Thread::DefaultStackSize(), _T("OCDMConstruct"))
+                , _parent(parent)
+            {
+                Run();
+            }
+            ~Runner()
+            {
+                Wait(Core::Thread::BLOCKED | Core::Thread::STOPPED, Core::infinite);
+            }
+
+        private:
+            uint32_t Worker() override
+            {
+                uint32_t delay = 0;
+
+                if (_parent.Process() == false) {
+                    Block();
+                    delay = Core::infinite;
+                }
+
+                return (delay);
+            }
+
+        private:
+            Constructions& _parent;
+        };
+
+    public:
+        Constructions(const Constructions&) = delete;
+        Constructions& operator=(const Constructions&) = delete;
+
+        Constructions(OpenCDMAccessor& accessor)
+            : _accessor(accessor)
+            , _adminLock()
+            , _signal(false, true)
+            , _jobs()
+            , _runners()
+            , _stopping(false)
+        {
+        }
+        ~Constructions()
+        {
+            Dispose();
+        }
+
+    public:
+        uint32_t Submit(OpenCDMSystem* system, OpenCDMSessionRequest requests[], const uint32_t count,
+            opencdm_sessions_constructed_callback callback, void* userData)
+        {
+            uint32_t result = OpenCDMError::ERROR_UNKNOWN;
+
+            ASSERT(count > 0);
+
+            _adminLock.Lock();
+
+            if (_stopping == false) {
+                Batch* batch = new Batch;
+
+                batch->System = system;
+                batch->Requests = requests;
+                batch->Count = count;
+                batch->Callback = callback;
+                batch->UserData = userData;
+                batch->Pending = count;
+
+                for (uint32_t index = 0; index < count; index++) {
+                    _jobs.push_back({ batch, index });
+                }
+
+                while ((_runners.size() < MaxRunners) && (_runners.size() < _jobs.size())) {
+                    _runners.push_back(new Runner(*this));
+                }
+
+                result = OpenCDMError::ERROR_NONE;
+            }
+
+            _adminLock.Unlock();
+
+            if (result == OpenCDMError::ERROR_NONE) {
+                _signal.SetEvent();
+            }
+
+            return (result);
+        }
+
+        // Joins the runners, must be called before the accessor starts to go
+        // away (opencdm_dispose), the constructions in progress still need it.
+        void Dispose()
+        {
+            _adminLock.Lock();
+
+            _stopping = true;
+
+            std::list<Job> abandoned;
+            abandoned.swap(_jobs);
+
+            std::list<Runner*> runners;
+            runners.swap(_runners);
+
+            _adminLock.Unlock();
+
+            _signal.SetEvent();
+
+            for (Runner* runner : runners) {
+                delete runner;
+            }
+
+            for (const Job& job : abandoned) {
+                OpenCDMSessionRequest& request(job.Owner->Requests[job.Index]);
+
+                request.session = nullptr;
+                request.result = OpenCDMError::ERROR_INVALID_ACCESSOR;
+
+                Done(job.Owner);
+            }
+        }
+
+    private:
+        // Runs one queued job, false once there is nothing left to do.
+        bool Process();
+
+        // The last one done with a batch reports it.
+        static void Done(Batch* batch)
+        {
+            if (batch->Pending.fetch_sub(1) == 1) {
+                batch->Callback(batch->System, batch->UserData, batch->Requests, batch->Count);
+
+                delete batch;
+            }
+        }
+
+    private:
+        OpenCDMAccessor& _accessor;
+        Core::CriticalSection _adminLock;
+        Core::Event _signal;
+        std::list<Job> _jobs;
+        std::list<Runner*> _runners;
+        bool _stopping;
+    };
 
 protected:
+PUSH_WARNING(DISABLE_WARNING_THIS_IN_MEMBER_INITIALIZER_LIST)
+
     OpenCDMAccessor(const TCHAR domainName[])
         : _refCount(1)
         , _domain()
@@ -58,9 +274,12 @@ protected:
         , _client()
         , _remote(nullptr)
         , _adminLock()
-        , _signal(false, true)
-        , _interested(0)
+        , _supported()
+        , _metadata()
+        , _sessionLock()
         , _sessionKeys()
+        , _keyIndex()
+        , _constructions(*this)
     {
         ASSERT(domainName != nullptr);
         _domain = domainName;
@@ -68,6 +287,8 @@ protected:
         Reconnect(); // make sure ResourceMonitor singleton is created before OpenCDMAccessor so the destruction order is correct
     }
 
+POP_WARNING()
+
     void Reconnect() const
     {
         TRACE_L1("Trying to open an OCDM connection @ %s", _domain.c_str());
@@ -84,6 +305,10 @@ protected:
                 _remote->Release();
             }
 
+            // Whatever we learned came from the previous OpenCDMImplementation.
+            _supported.clear();
+            _metadata.clear();
+
             _remote = _client->Open<Exchange::IAccessorOCDM>(_T("OpenCDMImplementation"));
 
             if (_remote == nullptr) {
@@ -98,8 +323,42 @@ protected:
         _adminLock.Unlock();
     }
 
+    // The lock only guards the pointer, the call itself is made without it,
+    // so (slow) calls to the OpenCDMImplementation do not serialize. The
+    // reference keeps the interface alive if a Reconnect swaps it meanwhile.
+    Exchange::IAccessorOCDM* Remote() const
+    {
+        _adminLock.Lock();
+
+        Exchange::IAccessorOCDM* result = _remote;
+
+        if (result != nullptr) {
+            result->AddRef();
+        }
+
+        _adminLock.Unlock();
+
+        return (result);
+    }
+
+    // Cached answers are only valid as long as the connection they came over
+    // is up. Must be called with the _adminLock taken.
+    bool IsConnected() const
+    {
+        bool result = ((_client.IsValid() == true) && (_client->IsOpen() == true) && (_remote != nullptr));
+
+        if (result == false) {
+            _supported.clear();
+            _metadata.clear();
+        }
+
+        return (result);
+    }
+
 public:
-    OpenCDMAccessor() : _signal(false, true) { ASSERT(false); }
+PUSH_WARNING(DISABLE_WARNING_THIS_IN_MEMBER_INITIALIZER_LIST)
+    OpenCDMAccessor() : _constructions(*this) { ASSERT(false); }
+POP_WARNING()
     OpenCDMAccessor(const OpenCDMAccessor&) = delete;
     OpenCDMAccessor& operator=(const OpenCDMAccessor&) = delete;
 
@@ -137,15 +396,11 @@ public:
     {
         uint32_t result = Core::ERROR_NONE;
 
-        _systemLock.Lock();
-
         if (Core::InterlockedDecrement(_refCount) == 0) {
             delete this;
             result = Core::ERROR_DESTRUCTION_SUCCEEDED;
         }
 
-        _systemLock.Unlock();
-
         return (result);
     }
 
@@ -163,29 +418,83 @@ public:
         // If ProxyStub return error for this call, there will be not next call from WebKit
         Reconnect();
 
+        const std::pair<string, string> key(keySystem, mimeType);
+        bool cached = false;
+
         _adminLock.Lock();
 
-        if (_remote != nullptr) {
-            result = _remote->IsTypeSupported(keySystem, mimeType);
+        if (IsConnected() == true) {
+            SupportCache::const_iterator index(_supported.find(key));
+
+            if (index != _supported.end()) {
+                result = index->second;
+                cached = true;
+            }
         }
 
         _adminLock.Unlock();
 
+        if (cached == false) {
+            Exchange::IAccessorOCDM* remote = Remote();
+
+            if (remote != nullptr) {
+                result = remote->IsTypeSupported(keySystem, mimeType);
+
+                _adminLock.Lock();
+
+                // A failed call reads as false as well, so only a positive answer
+                // is known to come from the server. And only remember it if it
+                // was not asked over a connection that is gone by now.
+                if ((result == true) && (remote == _remote)) {
+                    _supported[key] = result;
+                }
+
+                _adminLock.Unlock();
+
+                remote->Release();
+            }
+        }
+
         return result;
     }
 
     virtual Exchange::OCDM_RESULT Metadata(const string& keySystem, string& metadata) const override
     {
         Exchange::OCDM_RESULT result = Exchange::OCDM_INVALID_ACCESSOR;
+        bool cached = false;
 
         _adminLock.Lock();
 
-        if (_remote != nullptr) {
-            result = _remote->Metadata(keySystem, metadata);
+        if (IsConnected() == true) {
+            MetadataCache::const_iterator index(_metadata.find(keySystem));
+
+            if (index != _metadata.end()) {
+                metadata = index->second;
+                result = Exchange::OCDM_SUCCESS;
+                cached = true;
+            }
         }
 
         _adminLock.Unlock();
 
+        if (cached == false) {
+            Exchange::IAccessorOCDM* remote = Remote();
+
+            if (remote != nullptr) {
+                result = remote->Metadata(keySystem, metadata);
+
+                _adminLock.Lock();
+
+                if ((result == Exchange::OCDM_SUCCESS) && (remote == _remote)) {
+                    _metadata[keySystem] = metadata;
+                }
+
+                _adminLock.Unlock();
+
+                remote->Release();
+            }
+        }
+
         return (result);
     }
 
@@ -193,14 +502,13 @@ public:
     {
         Exchange::OCDM_RESULT result = Exchange::OCDM_INVALID_ACCESSOR;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->Metricdata(keySystem, length, buffer);
+        if (remote != nullptr) {
+            result = remote->Metricdata(keySystem, length, buffer);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
-
         return (result);
     }
 
@@ -215,15 +523,14 @@ public:
     {
         Exchange::OCDM_RESULT result = Exchange::OCDM_INVALID_ACCESSOR;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->CreateSession(keySystem, licenseType, initDataType, initData, initDataLength, CDMData,
-                        CDMDataLength, callback, sessionId, session);
+        if (remote != nullptr) {
+            result = remote->CreateSession(keySystem, licenseType, initDataType, initData, initDataLength, CDMData,
+                    CDMDataLength, callback, sessionId, session);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
-
         return (result);
     }
 
@@ -234,50 +541,33 @@ public:
     {
         Exchange::OCDM_RESULT result = Exchange::OCDM_INVALID_ACCESSOR;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->SetServerCertificate(keySystem, serverCertificate, serverCertificateLength);
+        if (remote != nullptr) {
+            result = remote->SetServerCertificate(keySystem, serverCertificate, serverCertificateLength);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
-
         return (result);
     }
 
     OpenCDMSession* Session(const std::string& sessionId);
 
     void AddSession(OpenCDMSession* sessionId);
-    void RemoveSession(const string& sessionId);
-    void KeyUpdate()
-    {
-        _adminLock.Lock();
-
-        if (_interested != 0) {
-            // We need to notify the "other side", they are expecting an update
-            _signal.SetEvent();
-
-            while (_interested != 0) {
-                ::SleepMs(0);
-            }
-
-            _signal.ResetEvent();
-        }
-        _adminLock.Unlock();
-    }
+    void RemoveSession(const OpenCDMSession* session);
+    void KeyUpdate(OpenCDMSession* session, const uint8_t keyId[], const uint8_t keyLength);
 
     uint64_t GetDrmSystemTime(const std::string& keySystem) const override
     {
         uint64_t result = 0;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->GetDrmSystemTime(keySystem);
+        if (remote != nullptr) {
+            result = remote->GetDrmSystemTime(keySystem);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
-
         return (result);
     }
 
@@ -285,14 +575,13 @@ public:
     {
         std::string result;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->GetVersionExt(keySystem);
+        if (remote != nullptr) {
+            result = remote->GetVersionExt(keySystem);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
-
         return (result);
     }
 
@@ -300,14 +589,13 @@ public:
     {
         uint32_t result = 0;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->GetLdlSessionLimit(keySystem);
+        if (remote != nullptr) {
+            result = remote->GetLdlSessionLimit(keySystem);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
-
         return (result);
     }
 
@@ -315,14 +603,13 @@ public:
     {
         bool result = false;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->IsSecureStopEnabled(keySystem);
+        if (remote != nullptr) {
+            result = remote->IsSecureStopEnabled(keySystem);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
-
         return (result);
     }
 
@@ -330,14 +617,13 @@ public:
     {
         Exchange::OCDM_RESULT result = Exchange::OCDM_INVALID_ACCESSOR;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->EnableSecureStop(keySystem, enable);
+        if (remote != nullptr) {
+            result = remote->EnableSecureStop(keySystem, enable);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
-
         return (result);
     }
 
@@ -345,14 +631,13 @@ public:
     {
         uint32_t result = 0;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->ResetSecureStops(keySystem);
+        if (remote != nullptr) {
+            result = remote->ResetSecureStops(keySystem);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
-
         return (result);
     }
 
@@ -362,14 +647,13 @@ public:
     {
         Exchange::OCDM_RESULT result = Exchange::OCDM_INVALID_ACCESSOR;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->GetSecureStopIds(keySystem, ids, idsLength, count);
+        if (remote != nullptr) {
+            result = remote->GetSecureStopIds(keySystem, ids, idsLength, count);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
-
         return (result);
     }
 
@@ -381,13 +665,102 @@ public:
     {
         Exchange::OCDM_RESULT result = Exchange::OCDM_INVALID_ACCESSOR;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->GetSecureStop(keySystem, sessionID, sessionIDLength, rawData, rawSize);
+        if (remote != nullptr) {
+            result = remote->GetSecureStop(keySystem, sessionID, sessionIDLength, rawData, rawSize);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
+        return (result);
+    }
+
+    // Fetches the secure stops of count sessions, whose IDs are packed back to
+    // back, into buffer as records of a 2 byte little endian length followed
+    // by the secure stop. Stops at the first one that fails or does not fit,
+    // on return count and bufferLength tell how many made it. A secure stop
+    // that does not fit in what is left of buffer is ERROR_BUFFER_TOO_SMALL.
+    uint32_t GetSecureStops(const std::string& keySystem,
+        const uint8_t sessionIDs[], const uint16_t sessionIDLength, uint32_t& count,
+        uint8_t buffer[], uint32_t& bufferLength)
+    {
+        uint32_t result = OpenCDMError::ERROR_INVALID_ACCESSOR;
+
+        Exchange::IAccessorOCDM* remote = Remote();
+
+        if (remote != nullptr) {
+            const uint32_t requested = count;
+            uint32_t used = 0;
+
+            result = OpenCDMError::ERROR_NONE;
+            count = 0;
+
+            while ((count < requested) && (result == OpenCDMError::ERROR_NONE)) {
+                if ((bufferLength - used) <= 2) {
+                    result = OpenCDMError::ERROR_BUFFER_TOO_SMALL;
+                } else {
+                    uint16_t rawSize = static_cast<uint16_t>(std::min<uint32_t>(bufferLength - used - 2, 0xFFFF));
+
+                    result = remote->GetSecureStop(keySystem, &(sessionIDs[count * sessionIDLength]), sessionIDLength, &(buffer[used + 2]), rawSize);
+
+                    if (result == Exchange::OCDM_SUCCESS) {
+                        buffer[used] = static_cast<uint8_t>(rawSize & 0xFF);
+                        buffer[used + 1] = static_cast<uint8_t>(rawSize >> 8);
+                        used += 2 + rawSize;
+                        count++;
+                    }
+                }
+            }
+
+            bufferLength = used;
+
+            remote->Release();
+        }
+
+        return (result);
+    }
+
+    // Commits the secure stops of count sessions, the server responses are
+    // records of a 2 byte little endian length followed by the response, in
+    // the order of the session IDs. On return count holds how many were
+    // committed. A record running past the end of the responses is
+    // ERROR_INVALID_ARG.
+    uint32_t CommitSecureStops(const std::string& keySystem,
+        const uint8_t sessionIDs[], const uint16_t sessionIDLength, uint32_t& count,
+        const uint8_t serverResponses[], const uint32_t serverResponsesLength)
+    {
+        uint32_t result = OpenCDMError::ERROR_INVALID_ACCESSOR;
+
+        Exchange::IAccessorOCDM* remote = Remote();
+
+        if (remote != nullptr) {
+            const uint32_t requested = count;
+            uint32_t used = 0;
+
+            result = OpenCDMError::ERROR_NONE;
+            count = 0;
+
+            while ((count < requested) && (result == OpenCDMError::ERROR_NONE)) {
+                uint16_t length = 0;
+
+                if ((serverResponsesLength - used) >= 2) {
+                    length = static_cast<uint16_t>(serverResponses[used] | (serverResponses[used + 1] << 8));
+                }
+
+                if (((serverResponsesLength - used) < 2) || ((serverResponsesLength - used - 2) < length)) {
+                    result = OpenCDMError::ERROR_INVALID_ARG;
+                } else {
+                    result = remote->CommitSecureStop(keySystem, &(sessionIDs[count * sessionIDLength]), sessionIDLength, &(serverResponses[used + 2]), length);
+
+                    if (result == Exchange::OCDM_SUCCESS) {
+                        used += 2 + length;
+                        count++;
+                    }
+                }
+            }
+
+            remote->Release();
+        }
 
         return (result);
     }
@@ -399,14 +772,13 @@ public:
     {
         Exchange::OCDM_RESULT result = Exchange::OCDM_INVALID_ACCESSOR;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->CommitSecureStop(keySystem, sessionID, sessionIDLength, serverResponse, serverResponseLength);
+        if (remote != nullptr) {
+            result = remote->CommitSecureStop(keySystem, sessionID, sessionIDLength, serverResponse, serverResponseLength);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
-
         return (result);
     }
 
@@ -415,14 +787,13 @@ public:
     {
         Exchange::OCDM_RESULT result = Exchange::OCDM_INVALID_ACCESSOR;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->DeleteKeyStore(keySystem);
+        if (remote != nullptr) {
+            result = remote->DeleteKeyStore(keySystem);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
-
         return (result);
     }
 
@@ -431,14 +802,13 @@ public:
     {
         Exchange::OCDM_RESULT result = Exchange::OCDM_INVALID_ACCESSOR;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->DeleteSecureStore(keySystem);
+        if (remote != nullptr) {
+            result = remote->DeleteSecureStore(keySystem);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
-
         return (result);
     }
 
@@ -448,14 +818,13 @@ public:
     {
         Exchange::OCDM_RESULT result = Exchange::OCDM_INVALID_ACCESSOR;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->GetKeyStoreHash(keySystem, keyStoreHash, keyStoreHashLength);
+        if (remote != nullptr) {
+            result = remote->GetKeyStoreHash(keySystem, keyStoreHash, keyStoreHashLength);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
-
         return (result);
     }
 
@@ -465,19 +834,30 @@ public:
     {
         Exchange::OCDM_RESULT result = Exchange::OCDM_INVALID_ACCESSOR;
 
-        _adminLock.Lock();
+        Exchange::IAccessorOCDM* remote = Remote();
 
-        if (_remote != nullptr) {
-            result = _remote->GetSecureStoreHash(keySystem, secureStoreHash, secureStoreHashLength);
+        if (remote != nullptr) {
+            result = remote->GetSecureStoreHash(keySystem, secureStoreHash, secureStoreHashLength);
+            remote->Release();
         }
 
-        _adminLock.Unlock();
-
         return (result);
     }
 
     void SystemBeingDestructed(OpenCDMSystem* system);
 
+    uint32_t ConstructSessions(OpenCDMSystem* system, OpenCDMSessionRequest requests[], const uint32_t count,
+        opencdm_sessions_constructed_callback callback, void* userData)
+    {
+        return (_constructions.Submit(system, requests, count, callback, userData));
+    }
+    // Finishes (or fails) the constructions in progress. Called while the
+    // accessor is still whole, the constructions and their callbacks use it.
+    void DisposeConstructions()
+    {
+        _constructions.Dispose();
+    }
+
 private:
     mutable uint32_t _refCount;
     string _domain;
@@ -485,14 +865,16 @@ private:
     mutable Core::ProxyType<RPC::CommunicatorClient> _client;
     mutable Exchange::IAccessorOCDM* _remote;
     mutable Core::CriticalSection _adminLock;
-    mutable Core::Event _signal;
-    mutable volatile uint32_t _interested;
+    mutable SupportCache _supported;
+    mutable MetadataCache _metadata;
+    mutable Core::CriticalSection _sessionLock;
     KeyMap _sessionKeys;
+    mutable KeyIndex _keyIndex;
+    Constructions _constructions;
 };
 
 struct OpenCDMSession {
 private:
-    using KeyStatusesMap = std::list<Exchange::KeyId>;
 
     class Sink : public Exchange::ISession::ICallback {
     //private:
@@ -544,14 +926,24 @@ private:
 
     class DataExchange : public Exchange::DataExchange {
     private:
+        static constexpr uint32_t DefaultSpin = 20;
+
         DataExchange() = delete;
         DataExchange(const DataExchange&) = delete;
         DataExchange& operator=(DataExchange&) = delete;
 
     public:
-        DataExchange(const string& bufferName)
+        DataExchange(const string& bufferName, DecryptStatistics& statistics)
             : Exchange::DataExchange(bufferName)
+            , _exchangeLock()
             , _busy(false)
+            , _claimant()
+            , _decrypted(false)
+            , _producer(false)
+            , _statistics(statistics)
+            , _start(0)
+            , _produced(0)
+            , _spin(MaxSpin())
         {
 
             TRACE_L1("Constructing buffer client side: %p - %s", this,
@@ -559,6 +951,9 @@ private:
         }
         virtual ~DataExchange()
         {
+            // A claimed region keeps its session, and with it this buffer, alive.
+            ASSERT(_claimant.load() == std::thread::id());
+
             if (_busy == true) {
                 TRACE_L1("Destructed a DataExchange while still in progress. %p", this);
             }
@@ -572,82 +967,697 @@ private:
             uint32_t initWithLast15,
             const ::MediaProperties* properties)
         {
-            int ret = 0;
+            // The shared buffer belongs to this session only, so all that needs
+            // to be serialized are the users of this session within this process
+            // (e.g. an audio and a video stream using the same session). Other
+            // sessions have their own buffer and can decrypt concurrently. If
+            // users of one session will be located in different processes, start
+            // using the administration space to share a lock.
+            // A thread holding a claimed region would wait for itself.
+            uint32_t result = Core::ERROR_ILLEGAL_STATE;
 
-            // This works, because we know that the Audio and the Video streams are
-            // fed from
-            // the same process, so they will use the same critial section and thus
-            // will
-            // not interfere with each-other. If Audio and video will be located into
-            // two
-            // different processes, start using the administartion space to share a
-            // lock.
-            _systemLock.Lock();
+            if (Claimed() == true) {
+                TRACE_L1("Decrypt on buffer %s while holding a claimed region", Name().c_str());
+            } else {
+                uint64_t start = DecryptStatistics::Now();
 
-            _busy = true;
+                _exchangeLock.Lock();
 
-            if (RequestProduce(Core::infinite) == Core::ERROR_NONE) {
-
-                CDMi::SubSampleInfo* subSample = nullptr;
-                uint8_t subSampleCount = 0;
-                CDMi::EncryptionScheme encScheme = CDMi::EncryptionScheme::AesCtr_Cenc;
-                CDMi::EncryptionPattern pattern = {0 , 0};
-                uint8_t* ivData = nullptr;
-                uint8_t ivDataLength = 0;
-                uint8_t* keyId = nullptr;
-                uint8_t keyIdLength = 0;
-
-                if(sampleInfo != nullptr) {
-                    subSample = reinterpret_cast<CDMi::SubSampleInfo*>(sampleInfo->subSample);
-                    subSampleCount = sampleInfo->subSampleCount;
-                    ivData = sampleInfo->iv;
-                    ivDataLength = sampleInfo->ivLength;
-                    keyId = sampleInfo->keyId;
-                    keyIdLength = sampleInfo->keyIdLength;
-                    encScheme = static_cast<CDMi::EncryptionScheme>(sampleInfo->scheme);
-                    pattern.clear_blocks = sampleInfo->pattern.clear_blocks;
-                    pattern.encrypted_blocks = sampleInfo->pattern.encrypted_blocks;
-                }
+                _statistics.Record(DecryptStatistics::LOCK_WAIT, start, DecryptStatistics::Now());
+
+                result = Submit(encryptedData, encryptedDataLength, sampleInfo, initWithLast15, properties);
 
-                SetIV(static_cast<uint8_t>(ivDataLength), ivData);
-                KeyId(static_cast<uint8_t>(keyIdLength), keyId);
-                SubSample(subSampleCount, subSample);
-                SetEncScheme(static_cast<uint8_t>(encScheme));
-                SetEncPattern(pattern.encrypted_blocks,pattern.clear_blocks);
-                InitWithLast15(initWithLast15);
-                if(properties != nullptr) {
-                    SetMediaProperties(properties->height, properties->width, properties->media_type);
+                if (result == Core::ERROR_NONE) {
+                    result = Complete(encryptedData, encryptedDataLength);
                 }
 
-                Write(encryptedDataLength, encryptedData);
+                _exchangeLock.Unlock();
+            }
 
-                // This will trigger the OpenCDMIServer to decrypt this memory...
-                Produced();
+            return (result);
+        }
 
-                // Now we should wait till it is decrypted, that happens if the
-                // Producer, can run again.
-                if (RequestProduce(Core::infinite) == Core::ERROR_NONE) {
+        // The two halves of a decrypt: Submit hands the sample to the
+        // OpenCDMIServer, Complete waits for it and copies the clear data back.
+        // Decrypt runs them back to back under the exchange lock. The slots of
+        // a DecryptRing are only used by the ring, which serializes them itself
+        // and keeps several of them in flight at once.
+        uint32_t Submit(uint8_t* encryptedData, uint32_t encryptedDataLength,
+            const ::SampleInfo* sampleInfo,
+            uint32_t initWithLast15,
+            const ::MediaProperties* properties)
+        {
+            _busy = true;
+            _start = DecryptStatistics::Now();
+
+            uint32_t result = RequestProduce(Core::infinite);
+            uint64_t end = DecryptStatistics::Now();
+
+            if (result == Core::ERROR_NONE) {
+                _statistics.Record(DecryptStatistics::PRODUCE_WAIT, _start, end);
+
+                Setup(sampleInfo, initWithLast15, properties);
+
+                Write(encryptedDataLength, encryptedData);
+
+                // This will trigger the OpenCDMIServer to decrypt this memory...
+                Produced();
+
+                _produced = DecryptStatistics::Now();
+            } else {
+                _statistics.Sample(encryptedDataLength, false, _start, end);
+
+                _busy = false;
+            }
+
+            return (result);
+        }
+
+        uint32_t Complete(uint8_t* clearData, uint32_t clearDataLength)
+        {
+            // Now we should wait till it is decrypted, that happens if the
+            // Producer, can run again.
+            uint32_t result = Turnaround();
+
+            uint64_t decrypted = DecryptStatistics::Now();
+            uint64_t end = decrypted;
+
+            if (result == Core::ERROR_NONE) {
+                _statistics.Record(DecryptStatistics::DECRYPT, _produced, decrypted);
+
+                // For nowe we just copy the clear data..
+                Read(clearDataLength, clearData);
+
+                end = DecryptStatistics::Now();
+                _statistics.Record(DecryptStatistics::COPY, decrypted, end);
+
+                // Get the status of the last decrypt.
+                result = Status();
+
+                // And free the lock, for the next production Scenario..
+                Consumed();
+            }
+
+            _statistics.Sample(clearDataLength, (result == Core::ERROR_NONE), _start, end);
+
+            _busy = false;
+
+            return (result);
+        }
+
+        uint32_t DecryptBatch(::SampleBuffer samples[], const uint32_t count,
+            const ::MediaProperties* properties)
+        {
+            uint32_t result = Core::ERROR_NONE;
+
+            if (Claimed() == true) {
+                TRACE_L1("DecryptBatch on buffer %s while holding a claimed region", Name().c_str());
+                result = Core::ERROR_ILLEGAL_STATE;
+            } else {
+                // Keep the exchange claimed for the whole batch, so the samples go
+                // back to back without interleaving with other users of this session.
+                _exchangeLock.Lock();
+
+                for (uint32_t index = 0; index < count; index++) {
+                    ::SampleBuffer& sample(samples[index]);
+
+                    uint32_t status = Core::ERROR_NONE;
+
+                    if (sample.length > 0) {
+                        status = Decrypt(sample.data, sample.length, sample.info, 0, properties);
+                    }
+
+                    sample.result = (status == Core::ERROR_NONE ? OpenCDMError::ERROR_NONE : OpenCDMError::ERROR_UNKNOWN);
+
+                    if ((status != Core::ERROR_NONE) && (result == Core::ERROR_NONE)) {
+                        result = status;
+                    }
+                }
+
+                _exchangeLock.Unlock();
+            }
+
+            return (result);
+        }
 
-                    // For nowe we just copy the clear data..
-                    Read(encryptedDataLength, encryptedData);
+        // In-place variant of Decrypt. Acquire claims the shared buffer
+        // and returns a writable region of the requested length, the caller
+        // fills it with the encrypted sample. DecryptInPlace has it decrypted
+        // by the OpenCDMIServer, after which the clear data is available in the
+        // very same region. Relinquish hands the buffer back for the next sample.
+        // A region is decrypted at most once, and a thread can hold only one.
+        uint8_t* Acquire(const uint32_t length)
+        {
+            uint8_t* result = nullptr;
+
+            if (Claimed() == true) {
+                TRACE_L1("Buffer %s already has a region claimed by this thread", Name().c_str());
+            } else {
+                uint64_t start = DecryptStatistics::Now();
+
+                _exchangeLock.Lock();
+
+                _busy = true;
+                _start = DecryptStatistics::Now();
+                _statistics.Record(DecryptStatistics::LOCK_WAIT, start, _start);
+
+                if (RequestProduce(Core::infinite) == Core::ERROR_NONE) {
+                    _statistics.Record(DecryptStatistics::PRODUCE_WAIT, _start, DecryptStatistics::Now());
+
+                    if (Size(length) == true) {
+                        result = Buffer();
+                        _decrypted = false;
+                        _producer = true;
+                        _claimant = std::this_thread::get_id();
+                    } else {
+                        TRACE_L1("Requested region of %u bytes does not fit in buffer %s", length, Name().c_str());
+
+                        // Nothing was produced, just hand the producer role back.
+                        Consumed();
+                    }
+                }
 
-                    // Get the status of the last decrypt.
-                    ret = Status();
+                if (result == nullptr) {
+                    _busy = false;
 
-                    // And free the lock, for the next production Scenario..
-                    Consumed();
+                    _exchangeLock.Unlock();
                 }
             }
 
+            return (result);
+        }
+
+        // True if nobody, in this or another process, is decrypting on this
+        // buffer right now. The producer role is taken and handed back right
+        // away, so the buffer is left as it was found.
+        bool Idle()
+        {
+            bool result = (RequestProduce(0) == Core::ERROR_NONE);
+
+            if (result == true) {
+                Consumed();
+            }
+
+            return (result);
+        }
+
+        // True if the calling thread holds a region claimed with Acquire.
+        bool Claimed() const
+        {
+            return (_claimant.load() == std::this_thread::get_id());
+        }
+
+        // True if the region claimed by the calling thread went through
+        // DecryptInPlace already.
+        bool Decrypted() const
+        {
+            ASSERT(Claimed() == true);
+
+            return (_decrypted);
+        }
+
+        uint32_t DecryptInPlace(const ::SampleInfo* sampleInfo,
+            uint32_t initWithLast15,
+            const ::MediaProperties* properties)
+        {
+            ASSERT(Claimed() == true);
+            ASSERT(_decrypted == false);
+
+            Setup(sampleInfo, initWithLast15, properties);
+
+            // This will trigger the OpenCDMIServer to decrypt this memory...
+            Produced();
+
+            _decrypted = true;
+            _produced = DecryptStatistics::Now();
+
+            uint32_t result = Turnaround();
+
+            // Unless the buffer came back, the OpenCDMIServer still has it and
+            // there is nothing to hand back on Relinquish.
+            _producer = (result == Core::ERROR_NONE);
+
+            uint64_t end = DecryptStatistics::Now();
+
+            if (result == Core::ERROR_NONE) {
+                _statistics.Record(DecryptStatistics::DECRYPT, _produced, end);
+
+                result = Status();
+            }
+
+            // Nothing to copy back, the clear data is already in place.
+            _statistics.Sample(static_cast<uint32_t>(Size()), (result == Core::ERROR_NONE), _start, end);
+
+            return (result);
+        }
+
+        void Relinquish()
+        {
+            ASSERT(Claimed() == true);
+
+            if (_producer == true) {
+                Consumed();
+                _producer = false;
+            }
+
+            _claimant = std::thread::id();
             _busy = false;
 
-            _systemLock.Unlock();
+            _exchangeLock.Unlock();
+        }
+
+    private:
+        // Upper bound (in microseconds) for polling the shared buffer before
+        // blocking on it. Spinning only makes sense if the OpenCDMIServer can
+        // run on another core meanwhile, so single core systems never spin.
+        static uint32_t MaxSpin()
+        {
+            static const uint32_t maxSpin = []() -> uint32_t {
+                uint32_t result = 0;
 
-            return (ret);
+                if (std::thread::hardware_concurrency() > 1) {
+                    string value;
+
+                    result = DefaultSpin;
+
+                    if (Core::SystemInfo::GetEnvironment(_T("OPEN_CDM_DECRYPT_SPIN"), value) == true) {
+                        result = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+                    }
+                }
+
+                return (result);
+            }();
+
+            return (maxSpin);
+        }
+
+        // Waits for the OpenCDMIServer to hand the buffer back. A decrypt often
+        // takes less than a wakeup from a blocking wait, so first poll for a
+        // while. The poll budget follows the observed turnaround: it grows
+        // back to the maximum when the server is quick and halves when the
+        // poll was in vain, after which the regular blocking wait takes over.
+        // The budget is kept on the monotonic clock of the statistics, a wall
+        // clock step would otherwise make the poll run away or the budget wrap.
+        uint32_t Turnaround()
+        {
+            uint32_t result = Core::ERROR_TIMEDOUT;
+            const uint64_t start = DecryptStatistics::Now();
+
+            if (_spin != 0) {
+                const uint64_t deadline = start + _spin;
+
+                do {
+                    result = RequestProduce(0);
+                } while ((result == Core::ERROR_TIMEDOUT) && (DecryptStatistics::Now() < deadline));
+            }
+
+            if (result == Core::ERROR_TIMEDOUT) {
+                result = RequestProduce(Core::infinite);
+            }
+
+            const uint32_t maxSpin = MaxSpin();
+            const uint64_t waited = DecryptStatistics::Now() - start;
+
+            if (waited <= maxSpin) {
+                _spin = std::min(maxSpin, static_cast<uint32_t>(waited * 2) + 1);
+            } else {
+                _spin /= 2;
+            }
+
+            return (result);
+        }
+
+        void Setup(const ::SampleInfo* sampleInfo, uint32_t initWithLast15, const ::MediaProperties* properties)
+        {
+            CDMi::SubSampleInfo* subSample = nullptr;
+            uint8_t subSampleCount = 0;
+            CDMi::EncryptionScheme encScheme = CDMi::EncryptionScheme::AesCtr_Cenc;
+            CDMi::EncryptionPattern pattern = {0 , 0};
+            uint8_t* ivData = nullptr;
+            uint8_t ivDataLength = 0;
+            uint8_t* keyId = nullptr;
+            uint8_t keyIdLength = 0;
+
+            if(sampleInfo != nullptr) {
+                subSample = reinterpret_cast<CDMi::SubSampleInfo*>(sampleInfo->subSample);
+                subSampleCount = sampleInfo->subSampleCount;
+                ivData = sampleInfo->iv;
+                ivDataLength = sampleInfo->ivLength;
+                keyId = sampleInfo->keyId;
+                keyIdLength = sampleInfo->keyIdLength;
+                encScheme = static_cast<CDMi::EncryptionScheme>(sampleInfo->scheme);
+                pattern.clear_blocks = sampleInfo->pattern.clear_blocks;
+                pattern.encrypted_blocks = sampleInfo->pattern.encrypted_blocks;
+            }
+
+            SetIV(static_cast<uint8_t>(ivDataLength), ivData);
+            KeyId(static_cast<uint8_t>(keyIdLength), keyId);
+            SubSample(subSampleCount, subSample);
+            SetEncScheme(static_cast<uint8_t>(encScheme));
+            SetEncPattern(pattern.encrypted_blocks,pattern.clear_blocks);
+            InitWithLast15(initWithLast15);
+            if(properties != nullptr) {
+                SetMediaProperties(properties->height, properties->width, properties->media_type);
+            }
         }
 
     private:
+        Core::CriticalSection _exchangeLock;
         bool _busy;
+        std::atomic<std::thread::id> _claimant;
+        bool _decrypted;
+        bool _producer;
+        DecryptStatistics& _statistics;
+        uint64_t _start;
+        uint64_t _produced;
+        uint32_t _spin;
+    };
+
+    // Keeps several samples of one session in flight. Every slot is a
+    // DataExchange of its own, so the OpenCDMIServer can decrypt sample k
+    // while sample k+1 is being written into the next slot. Samples complete
+    // in the order they were submitted. The slots are announced by the
+    // server when it creates the session buffer: "<buffer>#<slots>", slot k
+    // is then "<buffer>.<k>". A server that does not know about slots hands
+    // out a plain buffer name, in which case the samples are decrypted on
+    // submission through the session buffer and only their results queue up.
+    // A ring is meant to be driven by a single thread, e.g. the demuxer.
+    class DecryptRing {
+    private:
+        struct Slot {
+            DataExchange* Exchange;
+            uint8_t* Data;
+            uint32_t Length;
+            uint32_t Result;
+        };
+
+    public:
+        DecryptRing() = delete;
+        DecryptRing(const DecryptRing&) = delete;
+        DecryptRing& operator=(const DecryptRing&) = delete;
+
+        DecryptRing(DataExchange& session, const string& bufferName, const uint8_t slots, const uint8_t depth, DecryptStatistics& statistics)
+            : _session(session)
+            , _lock()
+            , _slots(slots > 0 ? slots : std::max(depth, static_cast<uint8_t>(1)))
+            , _head(0)
+            , _inFlight(0)
+        {
+            for (uint8_t index = 0; index < _slots.size(); index++) {
+                _slots[index].Exchange = (slots > 0 ? new DataExchange(bufferName + '.' + std::to_string(index + 1), statistics) : nullptr);
+                _slots[index].Data = nullptr;
+                _slots[index].Length = 0;
+                _slots[index].Result = Core::ERROR_NONE;
+            }
+        }
+        ~DecryptRing()
+        {
+            if (_inFlight != 0) {
+                TRACE_L1("Destructed a DecryptRing with %u samples in flight", _inFlight);
+            }
+
+            for (Slot& slot : _slots) {
+                delete slot.Exchange;
+            }
+        }
+
+        // Number of slots requested with OPEN_CDM_DECRYPT_SLOTS, zero if the
+        // session buffer is not to be split up.
+        static uint8_t Configured()
+        {
+            static const uint8_t configured = []() -> uint8_t {
+                uint32_t result = 0;
+                string value;
+
+                if (Core::SystemInfo::GetEnvironment(_T("OPEN_CDM_DECRYPT_SLOTS"), value) == true) {
+                    result = std::min(static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10)), static_cast<uint32_t>(MaxSlots));
+                }
+
+                return (static_cast<uint8_t>(result));
+            }();
+
+            return (configured);
+        }
+
+        // Splits a buffer name as handed out by the server in the name of the
+        // session buffer and the number of slots next to it.
+        static uint8_t Announced(string& bufferName)
+        {
+            uint32_t result = 0;
+            const size_t marker = bufferName.rfind('#');
+
+            if (marker != string::npos) {
+                result = std::min(static_cast<uint32_t>(std::strtoul(bufferName.c_str() + marker + 1, nullptr, 10)), static_cast<uint32_t>(MaxSlots));
+                bufferName.erase(marker);
+            }
+
+            return (static_cast<uint8_t>(result));
+        }
+
+    public:
+        uint32_t Submit(uint8_t data[], const uint32_t length,
+            const ::SampleInfo* sampleInfo,
+            const ::MediaProperties* properties)
+        {
+            uint32_t result = OpenCDMError::ERROR_BUFFER_TOO_SMALL;
+
+            _lock.Lock();
+
+            if (_inFlight < _slots.size()) {
+                Slot& slot(_slots[(_head + _inFlight) % _slots.size()]);
+
+                if (slot.Exchange != nullptr) {
+                    result = slot.Exchange->Submit(data, length, sampleInfo, 0, properties);
+                    slot.Result = result;
+                } else {
+                    slot.Result = _session.Decrypt(data, length, sampleInfo, 0, properties);
+                    result = Core::ERROR_NONE;
+                }
+
+                if (result == Core::ERROR_NONE) {
+                    slot.Data = data;
+                    slot.Length = length;
+                    _inFlight++;
+                } else {
+                    TRACE_L1("Submitting to decrypt slot failed with return code: %x", result);
+                    result = OpenCDMError::ERROR_UNKNOWN;
+                }
+            }
+
+            _lock.Unlock();
+
+            return (result);
+        }
+
+        uint32_t Complete(uint8_t*& data, uint32_t& length)
+        {
+            uint32_t result = OpenCDMError::ERROR_INVALID_DECRYPT_BUFFER;
+
+            _lock.Lock();
+
+            data = nullptr;
+            length = 0;
+
+            if (_inFlight > 0) {
+                Slot& slot(_slots[_head]);
+
+                result = (slot.Exchange != nullptr ? slot.Exchange->Complete(slot.Data, slot.Length) : slot.Result);
+
+                if (result != Core::ERROR_NONE) {
+                    TRACE_L1("Completing decrypt slot failed with return code: %x", result);
+                    result = OpenCDMError::ERROR_UNKNOWN;
+                }
+
+                data = slot.Data;
+                length = slot.Length;
+
+                slot.Data = nullptr;
+                slot.Length = 0;
+
+                _head = static_cast<uint8_t>((_head + 1) % _slots.size());
+                _inFlight--;
+            }
+
+            _lock.Unlock();
+
+            return (result);
+        }
+
+    private:
+        static constexpr uint8_t MaxSlots = 32;
+
+        DataExchange& _session;
+        Core::CriticalSection _lock;
+        std::vector<Slot> _slots;
+        uint8_t _head;
+        uint8_t _inFlight;
+    };
+
+    // Decrypts the samples queued with opencdm_session_decrypt_async in order
+    // of arrival and reports each one through its completion callback. The
+    // sample information is copied on queueing, the sample data itself is
+    // owned by the caller until its completion is reported.
+    class AsyncDecrypt : public Core::Thread {
+    private:
+        struct Request {
+            uint8_t* Data;
+            uint32_t Length;
+            bool HasInfo;
+            ::SampleInfo Info;
+            std::vector<uint8_t> IV;
+            std::vector<uint8_t> KeyId;
+            std::vector<::SubSampleInfo> SubSamples;
+            bool HasProperties;
+            ::MediaProperties Properties;
+            opencdm_decrypt_complete_callback Callback;
+            void* UserData;
+        };
+
+    public:
+        AsyncDecrypt() = delete;
+        AsyncDecrypt(const AsyncDecrypt&) = delete;
+        AsyncDecrypt& operator=(const AsyncDecrypt&) = delete;
+
+        AsyncDecrypt(OpenCDMSession& parent)
+            : Core::Thread(Core::Thread::DefaultStackSize(), _T("OCDMAsyncDecrypt"))
+            , _parent(parent)
+            , _adminLock()
+            , _signal(false, true)
+            , _queue()
+            , _stopping(false)
+        {
+            Run();
+        }
+        ~AsyncDecrypt()
+        {
+            // The session is on its way out, so whatever is still queued is not
+            // decrypted anymore. It is failed without the session though, the
+            // callers are waiting for their buffers to be handed back.
+            _adminLock.Lock();
+            _stopping = true;
+            _adminLock.Unlock();
+
+            _signal.SetEvent();
+
+            Wait(Core::Thread::BLOCKED | Core::Thread::STOPPED, Core::infinite);
+        }
+
+    public:
+        uint32_t Submit(uint8_t data[], const uint32_t length,
+            const ::SampleInfo* sampleInfo,
+            const ::MediaProperties* properties,
+            opencdm_decrypt_complete_callback callback, void* userData)
+        {
+            uint32_t result = OpenCDMError::ERROR_INVALID_SESSION;
+            Request request;
+
+            request.Data = data;
+            request.Length = length;
+            request.HasInfo = (sampleInfo != nullptr);
+            request.HasProperties = (properties != nullptr);
+            request.Callback = callback;
+            request.UserData = userData;
+
+            if (sampleInfo != nullptr) {
+                request.Info = *sampleInfo;
+
+                if (sampleInfo->iv != nullptr) {
+                    request.IV.assign(sampleInfo->iv, sampleInfo->iv + sampleInfo->ivLength);
+                }
+                if (sampleInfo->keyId != nullptr) {
+                    request.KeyId.assign(sampleInfo->keyId, sampleInfo->keyId + sampleInfo->keyIdLength);
+                }
+                if (sampleInfo->subSample != nullptr) {
+                    request.SubSamples.assign(sampleInfo->subSample, sampleInfo->subSample + sampleInfo->subSampleCount);
+                }
+            }
+
+            if (properties != nullptr) {
+                request.Properties = *properties;
+            }
+
+            _adminLock.Lock();
+
+            if (_stopping == false) {
+                _queue.push_back(std::move(request));
+                result = OpenCDMError::ERROR_NONE;
+            }
+
+            _adminLock.Unlock();
+
+            if (result == OpenCDMError::ERROR_NONE) {
+                _signal.SetEvent();
+            }
+
+            return (result);
+        }
+
+    private:
+        uint32_t Worker() override
+        {
+            uint32_t delay = 0;
+
+            _adminLock.Lock();
+
+            if (_queue.empty() == true) {
+                if (_stopping == true) {
+                    Block();
+                    delay = Core::infinite;
+                } else {
+                    _signal.ResetEvent();
+                }
+
+                _adminLock.Unlock();
+
+                if (delay == 0) {
+                    _signal.Lock(Core::infinite);
+                }
+            } else {
+                Request request(std::move(_queue.front()));
+                _queue.pop_front();
+
+                bool stopping = _stopping;
+
+                _adminLock.Unlock();
+
+                if (stopping == true) {
+                    if (request.Callback != nullptr) {
+                        request.Callback(nullptr, request.UserData, request.Data, request.Length, OpenCDMError::ERROR_INVALID_SESSION);
+                    }
+                } else {
+                    ::SampleInfo* info = nullptr;
+
+                    if (request.HasInfo == true) {
+                        // Point the copy at its own storage, the original is gone by now.
+                        request.Info.iv = (request.IV.empty() == true ? nullptr : request.IV.data());
+                        request.Info.keyId = (request.KeyId.empty() == true ? nullptr : request.KeyId.data());
+                        request.Info.subSample = (request.SubSamples.empty() == true ? nullptr : request.SubSamples.data());
+                        info = &request.Info;
+                    }
+
+                    uint32_t result = _parent.Decrypt(request.Data, request.Length, info, 0,
+                        (request.HasProperties == true ? &request.Properties : nullptr));
+
+                    // The session may have started to go away meanwhile.
+                    _adminLock.Lock();
+                    stopping = _stopping;
+                    _adminLock.Unlock();
+
+                    if (request.Callback != nullptr) {
+                        request.Callback((stopping == true ? nullptr : &_parent), request.UserData, request.Data, request.Length, static_cast<OpenCDMError>(result));
+                    }
+                }
+            }
+
+            return (delay);
+        }
+
+    private:
+        OpenCDMSession& _parent;
+        Core::CriticalSection _adminLock;
+        Core::Event _signal;
+        std::list<Request> _queue;
+        bool _stopping;
     };
 
 public:
@@ -657,7 +1667,8 @@ public:
 
 PUSH_WARNING(DISABLE_WARNING_THIS_IN_MEMBER_INITIALIZER_LIST)
 
-    OpenCDMSession(OpenCDMSystem* system,
+    OpenCDMSession(OpenCDMAccessor& accessor,
+        OpenCDMSystem* system,
         const string& initDataType,
         const uint8_t* pbInitData, const uint16_t cbInitData,
         const uint8_t* pbCustomData,
@@ -667,6 +1678,11 @@ PUSH_WARNING(DISABLE_WARNING_THIS_IN_MEMBER_INITIALIZER_LIST)
         void* userData)
         : _sessionId()
         , _decryptSession(nullptr)
+        , _decryptRing(nullptr)
+        , _decryptSlots(0)
+        , _decryptSetupLock()
+        , _asyncLock()
+        , _asyncDecrypt(nullptr)
         , _session(nullptr)
         , _sessionExt(nullptr)
         , _refCount(1)
@@ -674,19 +1690,22 @@ PUSH_WARNING(DISABLE_WARNING_THIS_IN_MEMBER_INITIALIZER_LIST)
         , _URL()
         , _callback(callbacks)
         , _userData(userData)
+        , _keyLock()
         , _keyStatuses()
+        , _statistics()
         , _error()
         , _errorCode(~0)
         , _sysError(Exchange::OCDM_RESULT::OCDM_SUCCESS)
         , _system(system)
         , _pvtData(nullptr)
+        , _adapterState(nullptr)
     {
         std::string bufferId;
         Exchange::ISession* realSession = nullptr;
 
         ASSERT(system != nullptr);
 
-        OpenCDMAccessor::Instance()->CreateSession(system->keySystem(), licenseType, initDataType, pbInitData,
+        accessor.CreateSession(system->keySystem(), licenseType, initDataType, pbInitData,
             cbInitData, pbCustomData, cbCustomData, &_sink,
             _sessionId, realSession);
 
@@ -695,7 +1714,7 @@ PUSH_WARNING(DISABLE_WARNING_THIS_IN_MEMBER_INITIALIZER_LIST)
         } else {
             Session(realSession);
             realSession->Release();
-            OpenCDMAccessor::Instance()->AddSession(this);
+            accessor.AddSession(this);
         }
     }
 
@@ -710,11 +1729,29 @@ public:
                             const uint8_t CDMData[], const uint16_t CDMDataLength,
                             OpenCDMSessionCallbacks* callbacks, void* userData,
                             struct OpenCDMSession** session);
+    static OpenCDMError CreateSession(OpenCDMAccessor& accessor,
+                            struct OpenCDMSystem* system,
+                            const LicenseType licenseType, const char initDataType[],
+                            const uint8_t initData[], const uint16_t initDataLength,
+                            const uint8_t CDMData[], const uint16_t CDMDataLength,
+                            OpenCDMSessionCallbacks* callbacks, void* userData,
+                            struct OpenCDMSession** session);
+
+    void AddRef() { _refCount.fetch_add(1, std::memory_order_relaxed); }
+    // Only takes a reference if the session is not on its way out already,
+    // used when a session is looked up rather than handed over by its owner.
+    bool TryAddRef()
+    {
+        uint32_t count = _refCount.load(std::memory_order_relaxed);
+
+        while ((count != 0) && (_refCount.compare_exchange_weak(count, count + 1, std::memory_order_acquire, std::memory_order_relaxed) == false)) {
+        }
 
-    void AddRef() { Core::InterlockedIncrement(_refCount); }
+        return (count != 0);
+    }
     bool Release()
     {
-        if (Core::InterlockedDecrement(_refCount) == 0) {
+        if (_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
 
             delete this;
 
@@ -743,19 +1780,23 @@ public:
     }
     inline Exchange::ISession::KeyStatus Status(const uint8_t keyIDLength, const uint8_t keyId[]) const
     {
-        Exchange::KeyId key(keyId, keyIDLength);
+        _keyLock.Lock();
+
+        Exchange::ISession::KeyStatus result = _keyStatuses.Status(keyId, keyIDLength);
 
-        KeyStatusesMap::const_iterator index = std::find(_keyStatuses.begin(), _keyStatuses.end(), key);
+        _keyLock.Unlock();
 
-        return index != _keyStatuses.end() ? index->Status() : Exchange::ISession::StatusPending;
+        return (result);
     }
     inline bool HasKeyId(const uint8_t keyIDLength, const uint8_t keyID[]) const
     {
-        Exchange::KeyId key(keyID, keyIDLength);
+        _keyLock.Lock();
+
+        bool result = _keyStatuses.Contains(keyID, keyIDLength);
 
-        KeyStatusesMap::const_iterator index = std::find(_keyStatuses.begin(), _keyStatuses.end(), key);
+        _keyLock.Unlock();
 
-        return (index != _keyStatuses.end());
+        return (result);
     }
     inline void Close()
     {
@@ -797,15 +1838,9 @@ public:
         uint32_t initWithLast15,
         const ::MediaProperties* properties)
     {
-        uint32_t result = OpenCDMError::ERROR_INVALID_DECRYPT_BUFFER;
+        DataExchange* decryptSession = nullptr;
 
-        // lazy create decryptbuffer
-        if(_decryptSession == nullptr) {
-            DecryptSession(_session);
-        }
-
-        // prevent unnecesary double atomic access
-        DataExchange* decryptSession = _decryptSession;
+        uint32_t result = DecryptBuffer(decryptSession);
 
         if (decryptSession != nullptr) {
             result = decryptSession->Decrypt(encryptedData, encryptedDataLength, 
@@ -821,11 +1856,182 @@ public:
         return (result);
     }
 
+    uint32_t Prepare()
+    {
+        DataExchange* decryptSession = nullptr;
+
+        return (DecryptBuffer(decryptSession));
+    }
+    uint32_t DecryptAsync(uint8_t data[], const uint32_t length,
+        const ::SampleInfo* sampleInfo,
+        const ::MediaProperties* properties,
+        opencdm_decrypt_complete_callback callback, void* userData)
+    {
+        _asyncLock.Lock();
+
+        // lazy create the decrypt thread, only sessions used asynchronously need one
+        if (_asyncDecrypt == nullptr) {
+            _asyncDecrypt = new AsyncDecrypt(*this);
+        }
+
+        uint32_t result = _asyncDecrypt->Submit(data, length, sampleInfo, properties, callback, userData);
+
+        _asyncLock.Unlock();
+
+        return (result);
+    }
+    uint32_t DecryptBatch(::SampleBuffer samples[], const uint32_t count,
+        const ::MediaProperties* properties)
+    {
+        DataExchange* decryptSession = nullptr;
+
+        uint32_t result = DecryptBuffer(decryptSession);
+
+        if (decryptSession != nullptr) {
+            result = decryptSession->DecryptBatch(samples, count, properties);
+            if(result)
+            {
+                TRACE_L1("DecryptBatch() failed with return code: %x", result);
+                result = OpenCDMError::ERROR_UNKNOWN;
+            }
+        }
+        return (result);
+    }
+    uint32_t DecryptSubmit(uint8_t data[], const uint32_t length,
+        const ::SampleInfo* sampleInfo,
+        const ::MediaProperties* properties)
+    {
+        DecryptRing* ring = nullptr;
+
+        uint32_t result = DecryptRingBuffer(ring);
+
+        if (ring != nullptr) {
+            result = ring->Submit(data, length, sampleInfo, properties);
+        }
+
+        return (result);
+    }
+    uint32_t DecryptComplete(uint8_t*& data, uint32_t& length)
+    {
+        uint32_t result = OpenCDMError::ERROR_INVALID_DECRYPT_BUFFER;
+
+        DecryptRing* ring = _decryptRing;
+
+        data = nullptr;
+        length = 0;
+
+        if (ring == nullptr) {
+            TRACE_L1("DecryptComplete() without a sample submitted on session %s", _sessionId.c_str());
+        } else {
+            result = ring->Complete(data, length);
+        }
+
+        return (result);
+    }
+    uint32_t AcquireBuffer(const uint32_t length, uint8_t*& buffer)
+    {
+        DataExchange* decryptSession = nullptr;
+
+        uint32_t result = DecryptBuffer(decryptSession);
+
+        buffer = nullptr;
+
+        if (decryptSession != nullptr) {
+            buffer = decryptSession->Acquire(length);
+
+            if (buffer == nullptr) {
+                result = OpenCDMError::ERROR_INVALID_DECRYPT_BUFFER;
+            } else {
+                // The claim keeps the session alive, it can only go after the
+                // region was released.
+                AddRef();
+            }
+        }
+
+        return (result);
+    }
+    uint32_t DecryptInPlace(const ::SampleInfo* sampleInfo,
+        const ::MediaProperties* properties)
+    {
+        uint32_t result = OpenCDMError::ERROR_INVALID_SESSION;
+
+        DataExchange* decryptSession = _decryptSession;
+
+        if (decryptSession == nullptr) {
+            TRACE_L1("DecryptInPlace() without a decrypt buffer on session %s", _sessionId.c_str());
+        } else if (decryptSession->Claimed() == false) {
+            TRACE_L1("DecryptInPlace() without a claimed region on session %s", _sessionId.c_str());
+            result = OpenCDMError::ERROR_INVALID_DECRYPT_BUFFER;
+        } else if (decryptSession->Decrypted() == true) {
+            TRACE_L1("DecryptInPlace() on a region decrypted already on session %s", _sessionId.c_str());
+            result = OpenCDMError::ERROR_INVALID_DECRYPT_BUFFER;
+        } else {
+            result = decryptSession->DecryptInPlace(sampleInfo, 0, properties);
+            if(result)
+            {
+                TRACE_L1("DecryptInPlace() failed with return code: %x", result);
+                result = OpenCDMError::ERROR_UNKNOWN;
+            }
+        }
+        return (result);
+    }
+    uint32_t ReleaseBuffer()
+    {
+        uint32_t result = OpenCDMError::ERROR_INVALID_SESSION;
+
+        DataExchange* decryptSession = _decryptSession;
+
+        if (decryptSession == nullptr) {
+            TRACE_L1("ReleaseBuffer() without a decrypt buffer on session %s", _sessionId.c_str());
+        } else if (decryptSession->Claimed() == false) {
+            TRACE_L1("ReleaseBuffer() without a claimed region on session %s", _sessionId.c_str());
+            result = OpenCDMError::ERROR_INVALID_DECRYPT_BUFFER;
+        } else {
+            decryptSession->Relinquish();
+            result = OpenCDMError::ERROR_NONE;
+
+            // Drop the reference of the claim, this might be the last one.
+            Release();
+        }
+
+        return (result);
+    }
+    void Statistics(OpenCDMSessionStatistics& statistics) const
+    {
+        _statistics.Snapshot(statistics);
+    }
+    void ClearSample(const uint32_t length)
+    {
+        _statistics.Clear(length);
+    }
+
     void* SessionPrivateData() const
     {
         return _pvtData;
     }
 
+    // Lets the GStreamer adapter keep state (e.g. parsed caps) with the
+    // session, it is deleted together with the session. The first state
+    // installed wins, a later one is deleted and the installed one returned.
+    struct AdapterState {
+        virtual ~AdapterState() = default;
+    };
+    AdapterState* Adapter() const
+    {
+        return (_adapterState.load());
+    }
+    AdapterState* Adapter(AdapterState* state)
+    {
+        AdapterState* installed = nullptr;
+
+        if (_adapterState.compare_exchange_strong(installed, state) == false) {
+            delete state;
+            state = installed;
+        }
+
+        return (state);
+    }
+
     uint32_t SessionIdExt() const
     {
         ASSERT(_sessionExt && "This method only works on Exchange::ISessionExt implementations.");
@@ -911,31 +2117,115 @@ protected:
             _sessionExt = _session->QueryInterface<Exchange::ISessionExt>();
         }
     }
-    void DecryptSession(Exchange::ISession* session)
+    // lazy create decryptbuffer, the first user sets it up, concurrent ones
+    // wait for it to be ready.
+    // Sets up the decrypt buffer on first use. Returns ERROR_NONE with the
+    // buffer in exchange, or the reason there is none.
+    uint32_t DecryptBuffer(DataExchange*& exchange)
     {
+        uint32_t result = OpenCDMError::ERROR_NONE;
+
+        // prevent unnecesary double atomic access
+        exchange = _decryptSession;
+
+        if (exchange == nullptr) {
+            _decryptSetupLock.Lock();
+
+            exchange = _decryptSession;
+
+            if (exchange == nullptr) {
+                result = (_session != nullptr ? DecryptSession(_session) : static_cast<uint32_t>(OpenCDMError::ERROR_INVALID_SESSION));
+                exchange = _decryptSession;
+            }
+
+            _decryptSetupLock.Unlock();
+        }
+
+        return (result);
+    }
+    // Sets up the decrypt ring on top of the decrypt buffer on first use.
+    uint32_t DecryptRingBuffer(DecryptRing*& ring)
+    {
+        DataExchange* exchange = nullptr;
+
+        uint32_t result = DecryptBuffer(exchange);
+
+        ring = _decryptRing;
+
+        if ((ring == nullptr) && (exchange != nullptr)) {
+            _decryptSetupLock.Lock();
+
+            ring = _decryptRing;
+
+            if (ring == nullptr) {
+                ring = new DecryptRing(*exchange, exchange->Name(), _decryptSlots, DecryptRing::Configured(), _statistics);
+                _decryptRing = ring;
+            }
+
+            _decryptSetupLock.Unlock();
+        }
+
+        return (result);
+    }
+    uint32_t DecryptSession(Exchange::ISession* session)
+    {
+        uint32_t result = OpenCDMError::ERROR_NONE;
+
         if (session == nullptr) {
+            delete _decryptRing.load();
+            _decryptRing = nullptr;
             delete _decryptSession.load();
             _decryptSession = nullptr;
         } else {
             std::string bufferid;
 
             ASSERT(_session != nullptr);
-            uint32_t result = _session->CreateSessionBuffer(bufferid);
 
-            if( result == 0 ) {
+            // Ask for decrypt slots next to the session buffer, servers that
+            // do not know about them just ignore the parameter.
+            if (DecryptRing::Configured() > 0) {
+                _session->SetParameter(_T("decrypt-slots"), std::to_string(DecryptRing::Configured()));
+            }
+
+            uint32_t created = _session->CreateSessionBuffer(bufferid);
+
+            if( created == 0 ) {
                 ASSERT (_decryptSession == nullptr);
-                _decryptSession = new DataExchange(bufferid); 
+                _decryptSlots = DecryptRing::Announced(bufferid);
+                _decryptSession = new DataExchange(bufferid, _statistics);
             }
-            else if ( result == 1 ) {
-                while( _decryptSession == nullptr ) {
-                    SleepMs(0);
+            else if ( created == 1 ) {
+                // The server already has a buffer for this session, but setting
+                // up is serialized, so it was not created for us. Attach to it
+                // if the server told us its name and nobody is using it at the
+                // moment, otherwise there is no way to share it safely and every
+                // decrypt has to say so.
+                if (bufferid.empty() == false) {
+                    TRACE_L1("DecryptSession was already created by the server, opening %s", bufferid.c_str());
+                    uint8_t slots = DecryptRing::Announced(bufferid);
+                    DataExchange* exchange = new DataExchange(bufferid, _statistics);
+
+                    if (exchange->Idle() == true) {
+                        _decryptSlots = slots;
+                        _decryptSession = exchange;
+                    } else {
+                        TRACE_L1("DecryptSession %s is in use, not sharing it with session %s", bufferid.c_str(), _sessionId.c_str());
+                        delete exchange;
+                        result = OpenCDMError::ERROR_BUSY_CANNOT_INITIALIZE;
+                    }
+                } else {
+                    TRACE_L1("DecryptSession was already created by the server, but not for session %s", _sessionId.c_str());
+                    result = OpenCDMError::ERROR_BUSY_CANNOT_INITIALIZE;
                 }
             }
             else {
                 ASSERT (_decryptSession == nullptr);
                 TRACE_L1("DecryptSession could not be created!");
+                result = OpenCDMError::ERROR_INVALID_DECRYPT_BUFFER;
             }
         }
+
+        return (result);
     }
    // Event fired when a key message is successfully created.
     void OnKeyMessage(const uint8_t keyMessage[], const uint16_t length, const std::string& URL)
@@ -963,17 +2253,13 @@ protected:
     // Event fired on key status update
     void OnKeyStatusUpdate(const uint8_t keyID[], const uint8_t keyIDLength, const Exchange::ISession::KeyStatus status)
     {   
-        Exchange::KeyId key(keyID, keyIDLength);
+        _keyLock.Lock();
 
-        KeyStatusesMap::iterator index = std::find(_keyStatuses.begin(), _keyStatuses.end(), key);
+        _keyStatuses.Status(keyID, keyIDLength, status);
 
-        if (index == _keyStatuses.end()) {
-            key.Status(status);
-            _keyStatuses.emplace_back(key);
-        }
-        else {
-            index->Status(status);
-        }
+        _keyLock.Unlock();
+
+        OpenCDMAccessor::Instance()->KeyUpdate(this, keyID, keyIDLength);
 
         if ((_callback != nullptr) && (_callback->key_update_callback != nullptr) && (status != Exchange::ISession::StatusPending)) {
             _callback->key_update_callback(this, _userData, keyID, keyIDLength);
@@ -990,18 +2276,26 @@ protected:
 private:
     std::string _sessionId;
     std::atomic<DataExchange*> _decryptSession;
+    std::atomic<DecryptRing*> _decryptRing;
+    uint8_t _decryptSlots;
+    Core::CriticalSection _decryptSetupLock;
+    Core::CriticalSection _asyncLock;
+    AsyncDecrypt* _asyncDecrypt;
     Exchange::ISession* _session;
     Exchange::ISessionExt* _sessionExt;
-    uint32_t _refCount;
+    std::atomic<uint32_t> _refCount;
     Core::SinkType<Sink> _sink;
     std::string _URL;
     OpenCDMSessionCallbacks* _callback;
     void* _userData; 
-    KeyStatusesMap _keyStatuses;
+    mutable Core::CriticalSection _keyLock;
+    KeyStatusTable _keyStatuses;
+    DecryptStatistics _statistics;
     std::string _error;
     uint32_t _errorCode;
     Exchange::OCDM_RESULT _sysError;
     OpenCDMSystem* _system;
     void* _pvtData;
+    std::atomic<AdapterState*> _adapterState;
 };
 
@@ -0,0 +1,45 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Metrological
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#ifndef MODULE_NAME
+#define MODULE_NAME OpenCDMBenchmark
+#endif
+
+#include <core/core.h>
+
+#include <chrono>
+
+namespace Thunder {
+namespace Benchmark {
+
+    // Monotonic time in microseconds. Core::Time follows the wall clock,
+    // which can step while a benchmark runs.
+    inline uint64_t Now()
+    {
+        return (static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()));
+    }
+
+    int KeyStatus(int argc, const char* argv[]);
+    int SubSamples(int argc, const char* argv[]);
+    int Decrypt(int argc, const char* argv[]);
+
+}
+}
@@ -0,0 +1,594 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Metrological
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Benchmarks.h"
+
+#include <com/com.h>
+#include <interfaces/IContentDecryption.h>
+#include <interfaces/IOCDM.h>
+#include <open_cdm.h>
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace Thunder {
+namespace Benchmark {
+
+    namespace {
+
+        constexpr TCHAR Connector[] = _T("/tmp/ocdmbenchmark");
+        constexpr TCHAR BufferPrefix[] = _T("/tmp/ocdmbenchmark.buffer.");
+        constexpr char KeySystem[] = "org.ocdmbenchmark.null";
+
+        // Stand-in for the OpenCDMImplementation in the OCDM plugin. It does
+        // not know any DRM, samples are "decrypted" by flipping bits, so all
+        // that is measured is the cost of getting them there and back. If the
+        // client asks for decrypt slots, every slot gets a buffer and a
+        // decryptor of its own next to the session buffer.
+        class Session : public Exchange::ISession {
+        private:
+            class Decryptor : public Core::Thread {
+            private:
+                class Buffer : public Exchange::DataExchange {
+                public:
+                    Buffer() = delete;
+                    Buffer(const Buffer&) = delete;
+                    Buffer& operator=(const Buffer&) = delete;
+                    ~Buffer() = default;
+
+                    Buffer(const string& name, const uint32_t size)
+                        : Exchange::DataExchange(name, size)
+                    {
+                    }
+
+                public:
+                    void Process()
+                    {
+                        if (RequestConsume(100) == Core::ERROR_NONE) {
+                            uint8_t* data = Exchange::DataExchange::Buffer();
+                            const uint32_t length = BytesWritten();
+
+                            for (uint32_t index = 0; index < length; index++) {
+                                data[index] ^= 0x5A;
+                            }
+
+                            Status(Core::ERROR_NONE);
+
+                            // Hands the producer role back, the client can collect the result.
+                            Consumed();
+                        }
+                    }
+                };
+
+            public:
+                Decryptor() = delete;
+                Decryptor(const Decryptor&) = delete;
+                Decryptor& operator=(const Decryptor&) = delete;
+
+                Decryptor(const string& name, const uint32_t size)
+                    : Core::Thread(Core::Thread::DefaultStackSize(), _T("BenchmarkDecryptor"))
+                    , _buffer(name, size)
+                    , _running(true)
+                {
+                    Run();
+                }
+                ~Decryptor()
+                {
+                    _running = false;
+                    Wait(Core::Thread::BLOCKED | Core::Thread::STOPPED, Core::infinite);
+                }
+
+            private:
+                uint32_t Worker() override
+                {
+                    uint32_t delay = 0;
+
+                    _buffer.Process();
+
+                    if (_running == false) {
+                        Block();
+                        delay = Core::infinite;
+                    }
+
+                    return (delay);
+                }
+
+            private:
+                Buffer _buffer;
+                std::atomic<bool> _running;
+            };
+
+        public:
+            Session() = delete;
+            Session(const Session&) = delete;
+            Session& operator=(const Session&) = delete;
+
+            Session(Exchange::ISession::ICallback* callback, const uint32_t bufferSize)
+                : _adminLock()
+                , _callback(callback)
+                , _bufferSize(bufferSize)
+                , _slots(0)
+                , _decryptors()
+            {
+                if (_callback != nullptr) {
+                    _callback->AddRef();
+                }
+            }
+            ~Session()
+            {
+                for (Decryptor* decryptor : _decryptors) {
+                    delete decryptor;
+                }
+
+                if (_callback != nullptr) {
+                    _callback->Release();
+                }
+            }
+
+        public:
+            Exchange::OCDM_RESULT Load() override
+            {
+                return (Exchange::OCDM_S_FALSE);
+            }
+            void Update(const uint8_t[], const uint16_t) override
+            {
+            }
+            Exchange::OCDM_RESULT Remove() override
+            {
+                return (Exchange::OCDM_S_FALSE);
+            }
+            std::string Metadata() const override
+            {
+                return (std::string());
+            }
+            Exchange::OCDM_RESULT Metricdata(uint32_t& bufferSize, uint8_t[]) const override
+            {
+                bufferSize = 0;
+                return (Exchange::OCDM_S_FALSE);
+            }
+            uint32_t CreateSessionBuffer(string& bufferId) override
+            {
+                static std::atomic<uint32_t> sequence(0);
+
+                _adminLock.Lock();
+
+                if (_decryptors.empty() == true) {
+                    const string name = string(BufferPrefix) + Core::NumberType<uint32_t>(sequence++).Text();
+
+                    _decryptors.push_back(new Decryptor(name, _bufferSize));
+
+                    for (uint8_t slot = 1; slot <= _slots; slot++) {
+                        _decryptors.push_back(new Decryptor(name + '.' + Core::NumberType<uint8_t>(slot).Text(), _bufferSize));
+                    }
+
+                    _bufferId = (_slots > 0 ? name + '#' + Core::NumberType<uint8_t>(_slots).Text() : name);
+                }
+
+                bufferId = _bufferId;
+
+                _adminLock.Unlock();
+
+                return (0);
+            }
+            void Close() override
+            {
+            }
+            void ResetOutputProtection() override
+            {
+            }
+            void SetParameter(const std::string& name, const std::string& value) override
+            {
+                if (name == _T("decrypt-slots")) {
+                    _adminLock.Lock();
+
+                    if (_decryptors.empty() == true) {
+                        _slots = static_cast<uint8_t>(std::min<uint32_t>(::atoi(value.c_str()), 32));
+                    }
+
+                    _adminLock.Unlock();
+                }
+            }
+            void Revoke(Exchange::ISession::ICallback* callback) override
+            {
+                _adminLock.Lock();
+
+                if ((_callback != nullptr) && (_callback == callback)) {
+                    _callback->Release();
+                    _callback = nullptr;
+                }
+
+                _adminLock.Unlock();
+            }
+
+            BEGIN_INTERFACE_MAP(Session)
+            INTERFACE_ENTRY(Exchange::ISession)
+            END_INTERFACE_MAP
+
+        private:
+            Core::CriticalSection _adminLock;
+            Exchange::ISession::ICallback* _callback;
+            const uint32_t _bufferSize;
+            string _bufferId;
+            uint8_t _slots;
+            std::vector<Decryptor*> _decryptors;
+        };
+
+        class Accessor : public Exchange::IAccessorOCDM {
+        public:
+            Accessor() = delete;
+            Accessor(const Accessor&) = delete;
+            Accessor& operator=(const Accessor&) = delete;
+
+            Accessor(const uint32_t bufferSize)
+                : _bufferSize(bufferSize)
+                , _sequence(0)
+            {
+            }
+            ~Accessor() = default;
+
+        public:
+            bool IsTypeSupported(const std::string& keySystem, const std::string&) const override
+            {
+                return (keySystem == KeySystem);
+            }
+            Exchange::OCDM_RESULT Metadata(const string&, string& metadata) const override
+            {
+                metadata.clear();
+                return (Exchange::OCDM_SUCCESS);
+            }
+            Exchange::OCDM_RESULT Metricdata(const string&, uint32_t& length, uint8_t[]) const override
+            {
+                length = 0;
+                return (Exchange::OCDM_S_FALSE);
+            }
+            Exchange::OCDM_RESULT CreateSession(const string&, const int32_t,
+                const std::string&, const uint8_t*, const uint16_t,
+                const uint8_t*, const uint16_t,
+                Exchange::ISession::ICallback* callback, std::string& sessionId,
+                Exchange::ISession*& session) override
+            {
+                sessionId = string(_T("benchmark-")) + Core::NumberType<uint32_t>(_sequence++).Text();
+                session = Core::Service<Session>::Create<Exchange::ISession>(callback, _bufferSize);
+
+                return (Exchange::OCDM_SUCCESS);
+            }
+            Exchange::OCDM_RESULT SetServerCertificate(const string&, const uint8_t*, const uint16_t) override
+            {
+                return (Exchange::OCDM_S_FALSE);
+            }
+            uint64_t GetDrmSystemTime(const std::string&) const override
+            {
+                return (Core::Time::Now().Ticks());
+            }
+            std::string GetVersionExt(const std::string&) const override
+            {
+                return (_T("1.0"));
+            }
+            uint32_t GetLdlSessionLimit(const std::string&) const override
+            {
+                return (0);
+            }
+            bool IsSecureStopEnabled(const std::string&) override
+            {
+                return (false);
+            }
+            Exchange::OCDM_RESULT EnableSecureStop(const std::string&, bool) override
+            {
+                return (Exchange::OCDM_S_FALSE);
+            }
+            uint32_t ResetSecureStops(const std::string&) override
+            {
+                return (0);
+            }
+            Exchange::OCDM_RESULT GetSecureStopIds(const std::string&, uint8_t[], uint16_t, uint32_t& count) override
+            {
+                count = 0;
+                return (Exchange::OCDM_SUCCESS);
+            }
+            Exchange::OCDM_RESULT GetSecureStop(const std::string&, const uint8_t[], uint16_t, uint8_t[], uint16_t& rawSize) override
+            {
+                rawSize = 0;
+                return (Exchange::OCDM_S_FALSE);
+            }
+            Exchange::OCDM_RESULT CommitSecureStop(const std::string&, const uint8_t[], uint16_t, const uint8_t[], uint16_t) override
+            {
+                return (Exchange::OCDM_S_FALSE);
+            }
+            Exchange::OCDM_RESULT DeleteKeyStore(const std::string&) override
+            {
+                return (Exchange::OCDM_S_FALSE);
+            }
+            Exchange::OCDM_RESULT DeleteSecureStore(const std::string&) override
+            {
+                return (Exchange::OCDM_S_FALSE);
+            }
+            Exchange::OCDM_RESULT GetKeyStoreHash(const std::string&, uint8_t[], uint16_t) override
+            {
+                return (Exchange::OCDM_S_FALSE);
+            }
+            Exchange::OCDM_RESULT GetSecureStoreHash(const std::string&, uint8_t[], uint16_t) override
+            {
+                return (Exchange::OCDM_S_FALSE);
+            }
+
+            BEGIN_INTERFACE_MAP(Accessor)
+            INTERFACE_ENTRY(Exchange::IAccessorOCDM)
+            END_INTERFACE_MAP
+
+        private:
+            const uint32_t _bufferSize;
+            std::atomic<uint32_t> _sequence;
+        };
+
+        class Server : public RPC::Communicator {
+        public:
+            Server() = delete;
+            Server(const Server&) = delete;
+            Server& operator=(const Server&) = delete;
+
+            Server(const Core::NodeId& node, Exchange::IAccessorOCDM* accessor)
+                : RPC::Communicator(node, _T(""), Core::ProxyType<Core::IIPCServer>(Core::ProxyType<RPC::InvokeServerType<1, 0, 4>>::Create()))
+                , _accessor(accessor)
+            {
+                _accessor->AddRef();
+                Open(Core::infinite);
+            }
+            ~Server()
+            {
+                Close(Core::infinite);
+                _accessor->Release();
+            }
+
+        private:
+            void* Acquire(const string& className, const uint32_t interfaceId, const uint32_t) override
+            {
+                void* result = nullptr;
+
+                if (className == _T("OpenCDMImplementation")) {
+                    result = _accessor->QueryInterface(interfaceId);
+                }
+
+                return (result);
+            }
+
+        private:
+            Exchange::IAccessorOCDM* _accessor;
+        };
+
+        struct Options {
+            uint32_t SampleSize;
+            uint8_t SubSamples;
+            uint32_t Sessions;
+            uint32_t Threads;
+            uint32_t Iterations;
+            uint8_t Slots;
+        };
+
+        uint32_t Argument(int argc, const char* argv[], const int index, const uint32_t defaultValue)
+        {
+            uint32_t value = (argc > index ? static_cast<uint32_t>(::atoi(argv[index])) : 0);
+
+            return (value != 0 ? value : defaultValue);
+        }
+
+        // Decrypts the same sample over and over on one session, recording the
+        // time every opencdm_session_decrypt_v2 call took (in microseconds).
+        // With decrypt slots the samples are pipelined through the decrypt
+        // ring instead, the time recorded runs from submission to completion.
+        void Drive(struct OpenCDMSession* session, const Options& options, std::vector<uint32_t>& latencies, uint32_t& failures)
+        {
+            std::vector<uint8_t> sample(options.SampleSize, 0xA5);
+            std::vector<SubSampleInfo> subSamples;
+            uint8_t keyId[16] = { 0 };
+            uint8_t iv[16] = { 0 };
+
+            // Split the sample evenly, a small clear header in front of every
+            // protected range, as in a typical CENC video sample.
+            if (options.SubSamples > 0) {
+                const uint32_t size = options.SampleSize / options.SubSamples;
+                const uint16_t clear = static_cast<uint16_t>(std::min<uint32_t>(size, 16));
+
+                for (uint8_t index = 0; index < options.SubSamples; index++) {
+                    subSamples.push_back({ clear, size - clear });
+                }
+
+                subSamples.back().encrypted_bytes += options.SampleSize - (size * options.SubSamples);
+            }
+
+            SampleInfo info;
+            info.scheme = AesCtr_Cenc;
+            info.pattern = { 0, 0 };
+            info.iv = iv;
+            info.ivLength = sizeof(iv);
+            info.keyId = keyId;
+            info.keyIdLength = sizeof(keyId);
+            info.subSampleCount = options.SubSamples;
+            info.subSample = (subSamples.empty() == true ? nullptr : subSamples.data());
+
+            MediaProperties properties = { 1080, 1920, MediaType_Video };
+
+            latencies.reserve(options.Iterations);
+
+            if (options.Slots == 0) {
+                for (uint32_t round = 0; round < options.Iterations; round++) {
+                    uint64_t start = Now();
+
+                    if (opencdm_session_decrypt_v2(session, sample.data(), options.SampleSize, &info, &properties) != ERROR_NONE) {
+                        failures++;
+                    }
+
+                    latencies.push_back(static_cast<uint32_t>(Now() - start));
+                }
+            } else {
+                // Every sample in flight needs a buffer of its own.
+                std::vector<std::vector<uint8_t>> buffers(options.Slots, sample);
+                std::deque<uint64_t> submitted;
+
+                auto complete = [&]() {
+                    uint8_t* data = nullptr;
+                    uint32_t length = 0;
+
+                    if (opencdm_session_decrypt_complete(session, &data, &length) != ERROR_NONE) {
+                        failures++;
+                    }
+
+                    latencies.push_back(static_cast<uint32_t>(Now() - submitted.front()));
+                    submitted.pop_front();
+                };
+
+                for (uint32_t round = 0; round < options.Iterations; round++) {
+                    if (submitted.size() == options.Slots) {
+                        complete();
+                    }
+
+                    submitted.push_back(Now());
+
+                    if (opencdm_session_decrypt_submit(session, buffers[round % options.Slots].data(), options.SampleSize, &info, &properties) != ERROR_NONE) {
+                        submitted.pop_back();
+                        failures++;
+                    }
+                }
+
+                while (submitted.empty() == false) {
+                    complete();
+                }
+            }
+        }
+
+        void Report(const char name[], const OpenCDMLatency& latency)
+        {
+            std::cout << "  " << name << "\t" << (latency.count != 0 ? latency.total / latency.count : 0) << " us average, " << latency.maximum << " us maximum" << std::endl;
+        }
+
+    }
+
+    int Decrypt(int argc, const char* argv[])
+    {
+        int result = 0;
+
+        Options options;
+        options.SampleSize = Argument(argc, argv, 0, 4096);
+        options.SubSamples = static_cast<uint8_t>(std::min<uint32_t>(Argument(argc, argv, 1, 0), 255));
+        options.Sessions = Argument(argc, argv, 2, 1);
+        options.Threads = std::max(Argument(argc, argv, 3, 1), options.Sessions);
+        options.Iterations = Argument(argc, argv, 4, 10000);
+        options.Slots = static_cast<uint8_t>(std::min<uint32_t>(Argument(argc, argv, 5, 0), 32));
+
+        // A decrypt ring is driven by a single thread.
+        if (options.Slots > 0) {
+            options.Threads = options.Sessions;
+        }
+
+        Core::SystemInfo::SetEnvironment(_T("OPEN_CDM_SERVER"), Connector);
+        Core::SystemInfo::SetEnvironment(_T("OPEN_CDM_DECRYPT_SLOTS"), Core::NumberType<uint8_t>(options.Slots).Text());
+
+        Exchange::IAccessorOCDM* accessor = Core::Service<Accessor>::Create<Exchange::IAccessorOCDM>(options.SampleSize);
+
+        {
+            Server server(Core::NodeId(Connector), accessor);
+
+            // The return code of the creation is not reliable, look at the system itself.
+            struct OpenCDMSystem* system = nullptr;
+            opencdm_create_system_extended(KeySystem, &system);
+
+            std::vector<struct OpenCDMSession*> sessions;
+
+            if (system != nullptr) {
+                for (uint32_t index = 0; index < options.Sessions; index++) {
+                    struct OpenCDMSession* session = nullptr;
+
+                    if ((opencdm_construct_session(system, Temporary, "cenc", nullptr, 0, nullptr, 0, nullptr, nullptr, &session) == ERROR_NONE) && (session != nullptr)) {
+                        sessions.push_back(session);
+                    }
+                }
+            }
+
+            if (sessions.size() != options.Sessions) {
+                std::cout << "could not set up " << options.Sessions << " sessions on the stub server" << std::endl;
+                result = -1;
+            } else {
+                std::vector<std::vector<uint32_t>> latencies(options.Threads);
+                std::vector<uint32_t> failures(options.Threads, 0);
+                std::vector<std::thread> threads;
+
+                uint64_t start = Now();
+
+                for (uint32_t index = 0; index < options.Threads; index++) {
+                    threads.emplace_back(Drive, sessions[index % options.Sessions], std::cref(options), std::ref(latencies[index]), std::ref(failures[index]));
+                }
+
+                for (std::thread& thread : threads) {
+                    thread.join();
+                }
+
+                uint64_t elapsed = std::max<uint64_t>(Now() - start, 1);
+
+                std::vector<uint32_t> all;
+                uint32_t failed = 0;
+
+                for (uint32_t index = 0; index < options.Threads; index++) {
+                    all.insert(all.end(), latencies[index].begin(), latencies[index].end());
+                    failed += failures[index];
+                }
+
+                std::sort(all.begin(), all.end());
+
+                const uint64_t samples = all.size();
+                const uint64_t bytes = samples * options.SampleSize;
+
+                std::cout << "sample size " << options.SampleSize << ", subsamples " << static_cast<uint32_t>(options.SubSamples)
+                          << ", sessions " << options.Sessions << ", threads " << options.Threads
+                          << ", slots " << static_cast<uint32_t>(options.Slots) << std::endl;
+                std::cout << "samples\t\t" << samples << " (" << failed << " failed)" << std::endl;
+                std::cout << "throughput\t" << ((samples * 1000000) / elapsed) << " samples/s, " << ((bytes * 1000000) / elapsed) / (1024 * 1024) << " MiB/s" << std::endl;
+                std::cout << "latency\t\tp50 " << all[samples / 2] << " us, p99 " << all[(samples * 99) / 100] << " us, maximum " << all.back() << " us" << std::endl;
+
+                OpenCDMSessionStatistics statistics;
+
+                if (opencdm_session_get_statistics(sessions[0], &statistics) == ERROR_NONE) {
+                    std::cout << "phases of the first session:" << std::endl;
+                    Report("lock wait", statistics.lockWait);
+                    Report("produce wait", statistics.produceWait);
+                    Report("decrypt", statistics.decrypt);
+                    Report("copy", statistics.copy);
+                }
+            }
+
+            for (struct OpenCDMSession* session : sessions) {
+                opencdm_destruct_session(session);
+            }
+
+            if (system != nullptr) {
+                opencdm_destruct_system(system);
+            }
+
+            // Drop the connection before the server goes away.
+            opencdm_dispose();
+        }
+
+        accessor->Release();
+
+        return (result);
+    }
+
+}
+}
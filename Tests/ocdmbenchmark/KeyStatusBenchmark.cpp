@@ -0,0 +1,118 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Metrological
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Benchmarks.h"
+
+#include <KeyStatusTable.h>
+
+#include <iostream>
+#include <list>
+#include <vector>
+
+namespace Thunder {
+namespace Benchmark {
+
+    namespace {
+
+        typedef std::vector<uint8_t> KeyBytes;
+
+        std::vector<KeyBytes> Keys(const uint16_t count)
+        {
+            std::vector<KeyBytes> keys;
+
+            for (uint16_t index = 0; index < count; index++) {
+                KeyBytes key(16);
+
+                for (uint8_t& byte : key) {
+                    byte = static_cast<uint8_t>(::rand());
+                }
+
+                keys.push_back(key);
+            }
+
+            return (keys);
+        }
+
+        template <typename LOOKUP>
+        uint64_t Measure(const std::vector<KeyBytes>& keys, const uint32_t iterations, LOOKUP lookup)
+        {
+            uint32_t found = 0;
+            uint64_t start = Now();
+
+            for (uint32_t round = 0; round < iterations; round++) {
+                const KeyBytes& key(keys[round % keys.size()]);
+
+                if (lookup(key) == Exchange::ISession::Usable) {
+                    found++;
+                }
+            }
+
+            uint64_t duration = Now() - start;
+
+            ASSERT(found == iterations);
+            DEBUG_VARIABLE(found);
+
+            // Ticks are in microseconds, report nanoseconds per lookup.
+            return ((duration * 1000) / iterations);
+        }
+
+    }
+
+    int KeyStatus(int argc, const char* argv[])
+    {
+        uint32_t iterations = (argc > 0 ? static_cast<uint32_t>(::atoi(argv[0])) : 1000000);
+        const uint16_t counts[] = { 1, 4, 16, 64, 128 };
+
+        if (iterations == 0) {
+            iterations = 1000000;
+        }
+
+        std::cout << "keys\tlist (ns)\ttable (ns)" << std::endl;
+
+        for (const uint16_t count : counts) {
+            std::vector<KeyBytes> keys(Keys(count));
+
+            std::list<Exchange::KeyId> list;
+            KeyStatusTable table;
+
+            for (const KeyBytes& key : keys) {
+                Exchange::KeyId id(key.data(), static_cast<uint8_t>(key.size()));
+                id.Status(Exchange::ISession::Usable);
+                list.push_back(id);
+                table.Status(key.data(), static_cast<uint8_t>(key.size()), Exchange::ISession::Usable);
+            }
+
+            uint64_t listTime = Measure(keys, iterations, [&list](const KeyBytes& key) {
+                Exchange::KeyId id(key.data(), static_cast<uint8_t>(key.size()));
+                std::list<Exchange::KeyId>::const_iterator index = std::find(list.begin(), list.end(), id);
+                return (index != list.end() ? index->Status() : Exchange::ISession::StatusPending);
+            });
+
+            uint64_t tableTime = Measure(keys, iterations, [&table](const KeyBytes& key) {
+                return (table.Status(key.data(), static_cast<uint8_t>(key.size())));
+            });
+
+            std::cout << count << "\t" << listTime << "\t\t" << tableTime << std::endl;
+        }
+
+        return (0);
+    }
+
+}
+}
@@ -0,0 +1,215 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Metrological
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Benchmarks.h"
+
+#include <iostream>
+#include <vector>
+
+namespace Thunder {
+namespace Benchmark {
+
+    // A model, not a measurement of the adapter: both subsample strategies of
+    // the GStreamer adapter are re-implemented here with an XOR standing in for
+    // the decrypt, so the numbers only compare the client side table parsing
+    // and copying of each strategy. The DRM decrypt and the shared buffer
+    // exchange are not included, see the decrypt benchmark for those.
+    namespace {
+
+        struct SubSample {
+            uint16_t Clear;
+            uint32_t Encrypted;
+        };
+
+        struct Layout {
+            const char* Name;
+            uint32_t SampleSize;
+            std::vector<SubSample> SubSamples;
+        };
+
+        // Big endian table as found in the GStreamer protection meta.
+        std::vector<uint8_t> Table(const std::vector<SubSample>& subSamples)
+        {
+            std::vector<uint8_t> table;
+
+            for (const SubSample& entry : subSamples) {
+                table.push_back(static_cast<uint8_t>(entry.Clear >> 8));
+                table.push_back(static_cast<uint8_t>(entry.Clear));
+                table.push_back(static_cast<uint8_t>(entry.Encrypted >> 24));
+                table.push_back(static_cast<uint8_t>(entry.Encrypted >> 16));
+                table.push_back(static_cast<uint8_t>(entry.Encrypted >> 8));
+                table.push_back(static_cast<uint8_t>(entry.Encrypted));
+            }
+
+            return (table);
+        }
+
+        inline uint16_t Read16(const uint8_t*& data)
+        {
+            uint16_t result = static_cast<uint16_t>((data[0] << 8) | data[1]);
+            data += 2;
+            return (result);
+        }
+
+        inline uint32_t Read32(const uint8_t*& data)
+        {
+            uint32_t result = (static_cast<uint32_t>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+            data += 4;
+            return (result);
+        }
+
+        // Stand-in for the decrypt itself, touches every byte it is given.
+        inline void Decrypt(uint8_t data[], const uint32_t length)
+        {
+            for (uint32_t index = 0; index < length; index++) {
+                data[index] ^= 0x5A;
+            }
+        }
+
+        // Model of the gather/scatter path (the adapter fallback for more than
+        // 255 subsamples): parse the table to size a temporary buffer, gather,
+        // decrypt, parse again and scatter.
+        void GatherScatter(uint8_t sample[], const uint8_t table[], const uint32_t count)
+        {
+            const uint8_t* reader = table;
+            uint32_t totalEncrypted = 0;
+
+            for (uint32_t position = 0; position < count; position++) {
+                Read16(reader);
+                totalEncrypted += Read32(reader);
+            }
+
+            uint8_t* encrypted = reinterpret_cast<uint8_t*>(::malloc(totalEncrypted));
+            uint8_t* iterator = encrypted;
+            uint32_t index = 0;
+
+            reader = table;
+            for (uint32_t position = 0; position < count; position++) {
+                uint16_t clear = Read16(reader);
+                uint32_t length = Read32(reader);
+
+                ::memcpy(iterator, sample + index + clear, length);
+                index += clear + length;
+                iterator += length;
+            }
+
+            Decrypt(encrypted, totalEncrypted);
+
+            index = 0;
+            uint32_t total = 0;
+            reader = table;
+            for (uint32_t position = 0; position < count; position++) {
+                uint16_t clear = Read16(reader);
+                uint32_t length = Read32(reader);
+
+                ::memcpy(sample + total + clear, encrypted + index, length);
+                index += length;
+                total += clear + length;
+            }
+
+            ::free(encrypted);
+        }
+
+        // Model of the in-place path: parse the table once into a stack array
+        // and let the protected ranges be decrypted in place.
+        void InPlace(uint8_t sample[], const uint8_t table[], const uint32_t count)
+        {
+            SubSample subSamples[255];
+            const uint8_t* reader = table;
+
+            for (uint32_t position = 0; position < count; position++) {
+                subSamples[position].Clear = Read16(reader);
+                subSamples[position].Encrypted = Read32(reader);
+            }
+
+            uint32_t index = 0;
+            for (uint32_t position = 0; position < count; position++) {
+                index += subSamples[position].Clear;
+                Decrypt(sample + index, subSamples[position].Encrypted);
+                index += subSamples[position].Encrypted;
+            }
+        }
+
+        template <typename METHOD>
+        uint64_t Measure(const Layout& layout, const uint32_t iterations, METHOD method)
+        {
+            std::vector<uint8_t> sample(layout.SampleSize, 0xA5);
+            std::vector<uint8_t> table(Table(layout.SubSamples));
+            const uint32_t count = static_cast<uint32_t>(layout.SubSamples.size());
+
+            uint64_t start = Now();
+
+            for (uint32_t round = 0; round < iterations; round++) {
+                method(sample.data(), table.data(), count);
+            }
+
+            // Now() is in microseconds, report nanoseconds per sample.
+            return (((Now() - start) * 1000) / iterations);
+        }
+
+        Layout Create(const char name[], const uint16_t clear, const uint32_t encrypted, const uint8_t count)
+        {
+            Layout layout;
+
+            layout.Name = name;
+            layout.SampleSize = 0;
+
+            for (uint8_t position = 0; position < count; position++) {
+                layout.SubSamples.push_back({ clear, encrypted });
+                layout.SampleSize += clear + encrypted;
+            }
+
+            return (layout);
+        }
+
+    }
+
+    int SubSamples(int argc, const char* argv[])
+    {
+        uint32_t iterations = (argc > 0 ? static_cast<uint32_t>(::atoi(argv[0])) : 10000);
+
+        if (iterations == 0) {
+            iterations = 10000;
+        }
+
+        // CENC video: NAL headers in the clear, slices encrypted. CBCS video:
+        // the same with the encrypted part a multiple of the AES block size.
+        const Layout layouts[] = {
+            Create("cenc-audio", 0, 512, 1),
+            Create("cenc-sd", 5, 4000, 4),
+            Create("cenc-4k", 5, 60000, 16),
+            Create("cbcs-sd", 37, 4000, 4),
+            Create("cbcs-4k", 37, 60000, 16)
+        };
+
+        std::cout << "modelled client side cost, XOR in place of the decrypt" << std::endl;
+        std::cout << "layout\t\tgather/scatter (ns)\tin place (ns)" << std::endl;
+
+        for (const Layout& layout : layouts) {
+            uint64_t gatherScatter = Measure(layout, iterations, GatherScatter);
+            uint64_t inPlace = Measure(layout, iterations, InPlace);
+
+            std::cout << layout.Name << "\t" << gatherScatter << "\t\t\t" << inPlace << std::endl;
+        }
+
+        return (0);
+    }
+
+}
+}
@@ -0,0 +1,53 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Metrological
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Benchmarks.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace Thunder;
+
+MODULE_NAME_DECLARATION(BUILD_REFERENCE)
+
+int main(int argc, const char* argv[])
+{
+    int result = -1;
+
+    if (argc < 2) {
+        cout << "usage: " << argv[0] << " <benchmark> [options]" << endl;
+        cout << "  keystatus [iterations]   key status lookups per number of keys in a session" << endl;
+        cout << "  subsamples [iterations]  model of the client side subsample handling per sample layout" << endl;
+        cout << "  decrypt [size] [subsamples] [sessions] [threads] [iterations] [slots]" << endl;
+        cout << "                           decrypts against an in-process stub OCDM server," << endl;
+        cout << "                           pipelined through a ring of [slots] buffers if given" << endl;
+    } else if (strcmp(argv[1], "keystatus") == 0) {
+        result = Benchmark::KeyStatus(argc - 2, &(argv[2]));
+    } else if (strcmp(argv[1], "subsamples") == 0) {
+        result = Benchmark::SubSamples(argc - 2, &(argv[2]));
+    } else if (strcmp(argv[1], "decrypt") == 0) {
+        result = Benchmark::Decrypt(argc - 2, &(argv[2]));
+    } else {
+        cout << "unknown benchmark " << argv[1] << endl;
+    }
+
+    Core::Singleton::Dispose();
+
+    return (result);
+}